@@ -0,0 +1,212 @@
+#include "font.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// each pixel of the default font becomes this many texels of the atlas
+#define font_scale 4
+// distances are stored up to this many texels from an edge, which is also
+// the padding around every glyph
+#define font_spread 4
+#define font_atlas_width 1024
+// the block of white texels shapes are drawn with, ahead of the glyphs
+#define font_white_size 6
+
+static const char* font_fragment_shader =
+#ifdef __ANDROID__
+    "#version 100\n"
+    "#extension GL_OES_standard_derivatives : enable\n"
+    "precision mediump float;\n"
+    "varying vec2 fragTexCoord;\n"
+    "varying vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec4 colDiffuse;\n"
+    "void main() {\n"
+    "    vec4 texel = texture2D(texture0, fragTexCoord);\n"
+    "    float width = max(fwidth(texel.a), 0.0001);\n"
+    "    float alpha = smoothstep(0.5 - width, 0.5 + width, texel.a);\n"
+    "    gl_FragColor = vec4(texel.rgb, alpha) * fragColor * colDiffuse;\n"
+    "}\n";
+#else
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform vec4 colDiffuse;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    vec4 texel = texture(texture0, fragTexCoord);\n"
+    "    float width = max(fwidth(texel.a), 0.0001);\n"
+    "    float alpha = smoothstep(0.5 - width, 0.5 + width, texel.a);\n"
+    "    finalColor = vec4(texel.rgb, alpha) * fragColor * colDiffuse;\n"
+    "}\n";
+#endif
+
+static Font font;
+static Shader font_shader;
+static bool font_ready = false;
+
+static bool glyph_inside(Image image, int x, int y) {
+    if (x < 0 || y < 0 || x >= image.width || y >= image.height) return false;
+    return GetImageColor(image, x, y).a > 127;
+}
+
+// Writes the distance field of a glyph image scaled up by font_scale into
+// the atlas at (ox, oy), padding included. Edges lie halfway between texels
+// of different sides, and the distance to the nearest one within the spread
+// is mapped so 0.5 is the edge and 1 is inside.
+static void glyph_render(Image image, unsigned char* atlas, int ox, int oy) {
+    int w = image.width * font_scale + 2 * font_spread;
+    int h = image.height * font_scale + 2 * font_spread;
+
+    unsigned char* inside = malloc(w * h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            // the padding is outside, floor keeps it from rounding in
+            int px = floorf((x - font_spread) / (float)font_scale);
+            int py = floorf((y - font_spread) / (float)font_scale);
+            inside[y * w + x] = glyph_inside(image, px, py);
+        }
+    }
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            bool in = inside[y * w + x];
+            float best = font_spread + 0.5f;
+            for (int dy = -font_spread; dy <= font_spread; dy++) {
+                int sy = y + dy;
+                if (sy < 0 || sy >= h) continue;
+                for (int dx = -font_spread; dx <= font_spread; dx++) {
+                    int sx = x + dx;
+                    if (sx < 0 || sx >= w || inside[sy * w + sx] == in) {
+                        continue;
+                    }
+                    float d = sqrtf(dx * dx + dy * dy);
+                    if (d < best) best = d;
+                }
+            }
+
+            float distance = (best - 0.5f) * (in ? 1 : -1);
+            float value = 0.5f + distance / (2 * font_spread);
+            if (value < 0) value = 0;
+            if (value > 1) value = 1;
+
+            unsigned char* texel =
+                &atlas[((oy + y) * font_atlas_width + ox + x) * 2];
+            texel[0] = 255;
+            texel[1] = value * 255;
+        }
+    }
+
+    free(inside);
+}
+
+void font_load(void) {
+    Font base = GetFontDefault();
+    if (!base.glyphs || !base.glyphs[0].image.data) return;
+
+    font.baseSize = base.baseSize * font_scale;
+    font.glyphCount = base.glyphCount;
+    font.glyphPadding = font_spread;
+    font.recs = malloc(base.glyphCount * sizeof(Rectangle));
+    font.glyphs = calloc(base.glyphCount, sizeof(GlyphInfo));
+
+    // shelf packing, rows as tall as the font
+    int x = font_white_size;
+    int y = 0;
+    int row_height = base.baseSize * font_scale + 2 * font_spread;
+    for (int i = 0; i < base.glyphCount; i++) {
+        int w = base.recs[i].width * font_scale + 2 * font_spread;
+        if (x + w > font_atlas_width) {
+            x = 0;
+            y += row_height;
+        }
+        font.recs[i] = (Rectangle){
+            x + font_spread,
+            y + font_spread,
+            base.recs[i].width * font_scale,
+            base.recs[i].height * font_scale,
+        };
+        x += w;
+    }
+    int height = y + row_height;
+
+    unsigned char* atlas = calloc(font_atlas_width * height, 2);
+    for (int y = 0; y < font_white_size; y++) {
+        for (int x = 0; x < font_white_size; x++) {
+            atlas[(y * font_atlas_width + x) * 2] = 255;
+            atlas[(y * font_atlas_width + x) * 2 + 1] = 255;
+        }
+    }
+
+    for (int i = 0; i < base.glyphCount; i++) {
+        font.glyphs[i] = (GlyphInfo){
+            .value = base.glyphs[i].value,
+            .offsetX = base.glyphs[i].offsetX * font_scale,
+            .offsetY = base.glyphs[i].offsetY * font_scale,
+            .advanceX = base.glyphs[i].advanceX * font_scale,
+        };
+        glyph_render(base.glyphs[i].image, atlas,
+                     font.recs[i].x - font_spread,
+                     font.recs[i].y - font_spread);
+    }
+
+    Image image = {
+        .data = atlas,
+        .width = font_atlas_width,
+        .height = height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA,
+    };
+    font.texture = LoadTextureFromImage(image);
+    free(atlas);
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+
+    font_shader = LoadShaderFromMemory(NULL, font_fragment_shader);
+    if (!font.texture.id || !IsShaderReady(font_shader)) {
+        font_unload();
+        return;
+    }
+
+    font_ready = true;
+    SetShapesTexture(font.texture, font_white_rect());
+}
+
+void font_unload(void) {
+    if (font_ready) {
+        font_ready = false;
+        SetShapesTexture(GetFontDefault().texture, font_white_rect());
+    }
+    if (font.texture.id) UnloadTexture(font.texture);
+    if (font_shader.id) UnloadShader(font_shader);
+    free(font.recs);
+    free(font.glyphs);
+    memset(&font, 0, sizeof(Font));
+    memset(&font_shader, 0, sizeof(Shader));
+}
+
+void font_begin(void) {
+    if (font_ready) BeginShaderMode(font_shader);
+}
+
+void font_end(void) {
+    if (font_ready) EndShaderMode();
+}
+
+const Font* font_get(void) {
+    static Font base;
+    if (font_ready) return &font;
+    base = GetFontDefault();
+    return &base;
+}
+
+Rectangle font_white_rect(void) {
+    // the middle of the white block, so filtering never reaches a glyph
+    if (font_ready) {
+        return (Rectangle){font_white_size / 2 - 1, font_white_size / 2 - 1,
+                           2, 2};
+    }
+    Font base = GetFontDefault();
+    return (Rectangle){base.recs[95].x + 2, base.recs[95].y + 2, 1, 1};
+}
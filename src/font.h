@@ -0,0 +1,29 @@
+#ifndef FONT_H_
+#define FONT_H_
+
+#include <raylib.h>
+
+// raylib's default font turned into a signed distance field atlas when the
+// window opens, so text of any size is drawn sharp from one texture. A shader
+// turns the distances back into coverage. The atlas also holds the white
+// texel shapes are drawn with, and shapes pass through the shader unchanged,
+// so text and rectangles in between font_begin and font_end share a texture
+// and a shader and raylib can batch all of them together.
+//
+// If anything fails the default font is used as is.
+
+void font_load(void);
+
+void font_unload(void);
+
+void font_begin(void);
+
+void font_end(void);
+
+// The distance field font, or the default font if it could not be made.
+const Font* font_get(void);
+
+// A white area of the font texture, for drawing rectangles with.
+Rectangle font_white_rect(void);
+
+#endif  // FONT_H_
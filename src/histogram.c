@@ -0,0 +1,102 @@
+#include "histogram.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define histogram_block_size 1024
+#define histogram_lanes 4
+
+bool histogram_count(const Number* items, size_t count, Number min,
+                     Number max, size_t* bins, size_t bin_count) {
+    if (!count || !bin_count) return true;
+
+    // doubles, since the range of the items may not fit a Number
+    double offset = min;
+    double scale = max > min ? bin_count / ((double)max - (double)min) : 0;
+    uint32_t last = bin_count - 1;
+
+    size_t* lanes = calloc(histogram_lanes * bin_count, sizeof(size_t));
+    if (!lanes) return false;
+    uint32_t indices[histogram_block_size];
+
+    for (size_t start = 0; start < count; start += histogram_block_size) {
+        size_t block = count - start;
+        if (block > histogram_block_size) block = histogram_block_size;
+        const Number* it = items + start;
+
+        for (size_t i = 0; i < block; i++) {
+            double x = ((double)it[i] - offset) * scale;
+            uint32_t index = x;
+            indices[i] = index < last ? index : last;
+        }
+
+        size_t i = 0;
+        for (; i + histogram_lanes <= block; i += histogram_lanes) {
+            for (size_t lane = 0; lane < histogram_lanes; lane++) {
+                lanes[lane * bin_count + indices[i + lane]]++;
+            }
+        }
+        for (; i < block; i++) lanes[indices[i]]++;
+    }
+
+    for (size_t lane = 0; lane < histogram_lanes; lane++) {
+        for (size_t b = 0; b < bin_count; b++) {
+            bins[b] += lanes[lane * bin_count + b];
+        }
+    }
+    free(lanes);
+    return true;
+}
+
+bool histogram_update(Histogram* histogram, Stack* stack, size_t bin_count) {
+    if (histogram->valid && histogram->generation == stack->generation &&
+        histogram->bin_count == bin_count) {
+        return false;
+    }
+
+    if (histogram->bin_count != bin_count) {
+        free(histogram->bins);
+        histogram->bins = malloc(bin_count * sizeof(size_t));
+        histogram->bin_count = histogram->bins ? bin_count : 0;
+    }
+    histogram->largest = 0;
+    histogram->valid = false;
+    if (!histogram->bins) return true;
+
+    histogram->min = histogram->max = 0;
+    if (stack->count) {
+        const StackStats* stats = stack_stats(stack);
+        histogram->min = stats->min;
+        histogram->max = stats->max;
+    }
+
+    memset(histogram->bins, 0, bin_count * sizeof(size_t));
+    for (size_t begin = 0, end; begin < stack->count; begin = end) {
+        end = stack_stream_next(stack, begin);
+        bool counted =
+            histogram_count(stack->items + begin, end - begin,
+                            histogram->min, histogram->max, histogram->bins,
+                            bin_count);
+        stack_stream_done(stack, begin, end);
+        if (!counted) {
+            memset(histogram->bins, 0, bin_count * sizeof(size_t));
+            return true;
+        }
+    }
+
+    for (size_t b = 0; b < bin_count; b++) {
+        if (histogram->bins[b] > histogram->largest) {
+            histogram->largest = histogram->bins[b];
+        }
+    }
+
+    histogram->generation = stack->generation;
+    histogram->valid = true;
+    return true;
+}
+
+void histogram_free(Histogram* histogram) {
+    free(histogram->bins);
+    memset(histogram, 0, sizeof(Histogram));
+}
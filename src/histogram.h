@@ -0,0 +1,38 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stddef.h>
+
+#include "number.h"
+#include "stack.h"
+
+// Counts of the stack items falling into bin_count equally wide bins between
+// the smallest and largest item, kept until the stack changes.
+typedef struct {
+    size_t* bins;
+    size_t bin_count;
+    size_t largest;
+    Number min;
+    Number max;
+    // generation of the stack the bins were counted from
+    size_t generation;
+    bool valid;
+} Histogram;
+
+// Adds the items to the counts in bins in a single pass. Bin indices are
+// computed a block at a time in a loop the compiler can vectorize, then
+// tallied into several interleaved copies of the bins so repeated values do
+// not stall on the same counter. Returns false, having counted nothing, if
+// those copies can not be allocated.
+bool histogram_count(const Number* items, size_t count, Number min,
+                     Number max, size_t* bins, size_t bin_count);
+
+// Recounts the histogram if the stack or the number of bins changed since it
+// was last counted. Returns true if it did. Out of memory it is left empty,
+// with bin_count 0 if the bins could not be allocated, and tried again on
+// the next call.
+bool histogram_update(Histogram* histogram, Stack* stack, size_t bin_count);
+
+void histogram_free(Histogram* histogram);
+
+#endif  // HISTOGRAM_H_
@@ -0,0 +1,216 @@
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static HistoryNode* history_node_new(History* history) {
+    HistoryNode* node = malloc(sizeof(HistoryNode));
+    node->refs = 1;
+    history->bytes += sizeof(HistoryNode);
+    return node;
+}
+
+static void history_node_release(History* history, HistoryNode* node,
+                                 int depth) {
+    if (!node || --node->refs) return;
+    if (depth) {
+        for (size_t i = 0; i < history_branch; i++) {
+            history_node_release(history, node->as.children[i], depth - 1);
+        }
+    }
+    free(node);
+    history->bytes -= sizeof(HistoryNode);
+}
+
+static size_t history_span(int depth) {
+    return (size_t)history_chunk_size << (history_bits * depth);
+}
+
+static int history_depth(size_t count) {
+    int depth = 0;
+    while (history_span(depth) < count) depth++;
+    return depth;
+}
+
+// Builds the node covering items from base on at the given depth. prev is the
+// node of the previous version covering the same items, or, when the previous
+// version was shallower, its root at prev_depth while still on the leftmost
+// path. Subtrees that are full and entirely below clean are shared.
+static HistoryNode* history_build(History* history, HistoryNode* prev,
+                                  int prev_depth, int depth, size_t base,
+                                  size_t clean, Stack* stack) {
+    size_t span = history_span(depth);
+    if (prev && prev_depth == depth && base + span <= clean) {
+        prev->refs++;
+        return prev;
+    }
+
+    HistoryNode* node = history_node_new(history);
+
+    if (depth == 0) {
+        size_t n = stack->count - base;
+        if (n > history_chunk_size) n = history_chunk_size;
+        memcpy(node->as.items, &stack->items[base], n * sizeof(Number));
+        return node;
+    }
+
+    size_t child_span = span / history_branch;
+    for (size_t i = 0; i < history_branch; i++) {
+        size_t child_base = base + i * child_span;
+        if (child_base >= stack->count) {
+            node->as.children[i] = NULL;
+            continue;
+        }
+
+        HistoryNode* child_prev = NULL;
+        int child_prev_depth = prev_depth;
+        if (prev && prev_depth < depth) {
+            if (i == 0) child_prev = prev;
+        } else if (prev) {
+            child_prev = prev->as.children[i];
+            child_prev_depth = prev_depth - 1;
+        }
+
+        node->as.children[i] =
+            history_build(history, child_prev, child_prev_depth, depth - 1,
+                          child_base, clean, stack);
+    }
+
+    return node;
+}
+
+void history_commit(History* history, Stack* stack) {
+    HistoryVersion* prev =
+        history->count ? &history->versions[history->current] : NULL;
+
+    if (prev && stack->dirty_from >= stack->count &&
+        stack->count == prev->count) {
+        return;
+    }
+
+    // a copy of a stack past the memory budget would not fit in memory
+    // either, so there is no undo until it shrinks again
+    if (stack_memory_budget &&
+        stack->count * sizeof(Number) > stack_memory_budget) {
+        history_free(history);
+        stack->dirty_from = stack->count;
+        return;
+    }
+
+    for (size_t i = history->current + 1; i < history->count; i++) {
+        history_node_release(history, history->versions[i].root,
+                             history->versions[i].depth);
+    }
+    if (history->count) history->count = history->current + 1;
+
+    if (history->count == history->capacity) {
+        history->capacity = history->capacity ? history->capacity * 2 : 64;
+        history->versions = realloc(history->versions,
+                                    history->capacity * sizeof(HistoryVersion));
+        prev = history->count ? &history->versions[history->current] : NULL;
+    }
+
+    HistoryVersion version = {
+        .count = stack->count,
+        .depth = history_depth(stack->count),
+    };
+
+    if (stack->count) {
+        HistoryNode* prev_root = NULL;
+        int prev_depth = 0;
+        size_t clean = 0;
+        if (prev && prev->root) {
+            prev_root = prev->root;
+            prev_depth = prev->depth;
+            while (prev_depth > version.depth) {
+                prev_root = prev_root->as.children[0];
+                prev_depth--;
+            }
+            clean = stack->dirty_from;
+            if (clean > prev->count) clean = prev->count;
+            if (clean > stack->count) clean = stack->count;
+        }
+        version.root = history_build(history, prev_root, prev_depth,
+                                     version.depth, 0, clean, stack);
+    }
+
+    history->current = history->count;
+    history->versions[history->count++] = version;
+    stack->dirty_from = stack->count;
+}
+
+// Copies the items of target that differ from current into the stack, where
+// current is the version the stack holds right now. Depths follow the same
+// rules as in history_build.
+static void history_restore(HistoryNode* target, int depth,
+                            HistoryNode* current, int current_depth,
+                            size_t base, size_t count, Number* items) {
+    if (!target) return;
+    if (target == current && depth == current_depth) return;
+
+    if (depth == 0) {
+        size_t n = count - base;
+        if (n > history_chunk_size) n = history_chunk_size;
+        memcpy(&items[base], target->as.items, n * sizeof(Number));
+        return;
+    }
+
+    size_t child_span = history_span(depth - 1);
+    for (size_t i = 0; i < history_branch; i++) {
+        size_t child_base = base + i * child_span;
+        if (child_base >= count) break;
+
+        HistoryNode* child_current = NULL;
+        int child_current_depth = current_depth;
+        if (current && current_depth < depth) {
+            if (i == 0) child_current = current;
+        } else if (current) {
+            child_current = current->as.children[i];
+            child_current_depth = current_depth - 1;
+        }
+
+        history_restore(target->as.children[i], depth - 1, child_current,
+                        child_current_depth, child_base, count, items);
+    }
+}
+
+static bool history_checkout(History* history, Stack* stack, size_t index) {
+    HistoryVersion* current = &history->versions[history->current];
+    HistoryVersion* target = &history->versions[index];
+
+    HistoryNode* current_root = current->root;
+    int current_depth = current->depth;
+    while (current_root && current_depth > target->depth) {
+        current_root = current_root->as.children[0];
+        current_depth--;
+    }
+
+    if (!stack_reserve(stack, target->count)) return false;
+    history_restore(target->root, target->depth, current_root, current_depth,
+                    0, target->count, stack->items);
+
+    stack->count = target->count;
+    stack->dirty_from = stack->count;
+    stack_invalidate_stats(stack);
+    history->current = index;
+    return true;
+}
+
+bool history_undo(History* history, Stack* stack) {
+    if (!history->count || history->current == 0) return false;
+    return history_checkout(history, stack, history->current - 1);
+}
+
+bool history_redo(History* history, Stack* stack) {
+    if (history->current + 1 >= history->count) return false;
+    return history_checkout(history, stack, history->current + 1);
+}
+
+void history_free(History* history) {
+    for (size_t i = 0; i < history->count; i++) {
+        history_node_release(history, history->versions[i].root,
+                             history->versions[i].depth);
+    }
+    free(history->versions);
+    memset(history, 0, sizeof(History));
+}
@@ -0,0 +1,52 @@
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stddef.h>
+
+#include "stack.h"
+
+// Undo history of the stack. Every version is a persistent trie of
+// fixed-size chunks, and a new version shares every chunk that lies below the
+// stack's dirty_from mark with the previous one. Pushing or popping a value
+// therefore costs one chunk plus one node per level, and undoing or redoing
+// only copies back the chunks that differ between the two versions.
+
+#define history_bits 5
+#define history_branch (1 << history_bits)
+#define history_chunk_size history_branch
+
+typedef struct HistoryNode {
+    size_t refs;
+    union {
+        struct HistoryNode* children[history_branch];
+        Number items[history_chunk_size];
+    } as;
+} HistoryNode;
+
+typedef struct {
+    HistoryNode* root;
+    size_t count;
+    int depth;
+} HistoryVersion;
+
+typedef struct {
+    HistoryVersion* versions;
+    size_t count;
+    size_t capacity;
+    size_t current;
+    // memory held by the nodes of all versions
+    size_t bytes;
+} History;
+
+// Records the stack as a new version if it changed since the last one,
+// dropping anything that could have been redone. Stacks larger than the
+// stack memory budget are not recorded and clear the history.
+void history_commit(History* history, Stack* stack);
+
+bool history_undo(History* history, Stack* stack);
+
+bool history_redo(History* history, Stack* stack);
+
+void history_free(History* history);
+
+#endif  // HISTORY_H_
@@ -1,5 +1,11 @@
 #include "imgui.h"
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font.h"
+
 size_t button_normal_color = 2;
 size_t button_pressed_color = 0;
 
@@ -58,28 +64,435 @@ static Vector2 get_rect_center(Rectangle rec) {
     };
 }
 
+// draw list
+
+typedef struct {
+    Texture2D texture;
+    Rectangle source;
+    Rectangle dest;
+    Color color;
+    // index into scissors, or -1
+    int scissor;
+    // drawn without the font shader
+    bool raw;
+} DrawQuad;
+
+typedef struct {
+    DrawQuad* quads;
+    size_t count;
+    size_t capacity;
+    Rectangle* scissors;
+    size_t scissor_count;
+    size_t scissor_capacity;
+    int scissor;
+    // the scissor could not be stored, so what it clips is dropped
+    bool scissor_lost;
+    size_t draw_calls;
+} DrawList;
+
+static DrawList draw_list = {.scissor = -1};
+size_t im_frame_draw_calls = 0;
+
+static void draw_list_add(Texture2D texture, Rectangle source,
+                          Rectangle dest, Color color, bool raw) {
+    DrawList* list = &draw_list;
+    if (list->scissor_lost) return;
+    if (list->count == list->capacity) {
+        // out of memory the quad is not drawn
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        DrawQuad* quads = realloc(list->quads, capacity * sizeof(DrawQuad));
+        if (!quads) return;
+        list->quads = quads;
+        list->capacity = capacity;
+    }
+    list->quads[list->count++] = (DrawQuad){
+        .texture = texture,
+        .source = source,
+        .dest = dest,
+        .color = color,
+        .scissor = list->scissor,
+        .raw = raw,
+    };
+}
+
+void im_rect(Rectangle rec, Color color) {
+    draw_list_add(font_get()->texture, font_white_rect(), rec, color, false);
+}
+
+void draw_text(const char* text, float x, float y, int font_size,
+               Color color) {
+    // DrawText does not go below the size of the default font
+    if (font_size < 10) font_size = 10;
+    draw_text_ex(text, (Vector2){x, y}, font_size, font_size / 10, color);
+}
+
+// Lays glyphs out the way DrawTextEx does.
+void draw_text_ex(const char* text, Vector2 position, float font_size,
+                  float spacing, Color color) {
+    const Font* font = font_get();
+    float scale = font_size / font->baseSize;
+    float padding = font->glyphPadding;
+    float x = 0;
+
+    for (const char* it = text; *it;) {
+        int size;
+        int codepoint = GetCodepointNext(it, &size);
+        it += size;
+
+        int index = GetGlyphIndex(*font, codepoint);
+        Rectangle rec = font->recs[index];
+        const GlyphInfo* glyph = &font->glyphs[index];
+
+        if (codepoint != ' ' && codepoint != '\t') {
+            Rectangle source = {rec.x - padding, rec.y - padding,
+                                rec.width + 2 * padding,
+                                rec.height + 2 * padding};
+            Rectangle dest = {
+                position.x + x + (glyph->offsetX - padding) * scale,
+                position.y + (glyph->offsetY - padding) * scale,
+                source.width * scale,
+                source.height * scale,
+            };
+            draw_list_add(font->texture, source, dest, color, false);
+        }
+
+        x += (glyph->advanceX ? glyph->advanceX : rec.width) * scale + spacing;
+    }
+}
+
+void im_texture(Texture2D texture, Rectangle source, Rectangle dest) {
+    draw_list_add(texture, source, dest, WHITE, true);
+}
+
+void im_scissor_begin(Rectangle rec) {
+    DrawList* list = &draw_list;
+    if (list->scissor_count == list->scissor_capacity) {
+        size_t capacity =
+            list->scissor_capacity ? list->scissor_capacity * 2 : 16;
+        Rectangle* scissors =
+            realloc(list->scissors, capacity * sizeof(Rectangle));
+        if (!scissors) {
+            list->scissor_lost = true;
+            return;
+        }
+        list->scissors = scissors;
+        list->scissor_capacity = capacity;
+    }
+    list->scissors[list->scissor_count] = rec;
+    list->scissor = list->scissor_count++;
+}
+
+void im_scissor_end(void) {
+    draw_list.scissor = -1;
+    draw_list.scissor_lost = false;
+}
+
+void im_flush(void) {
+    DrawList* list = &draw_list;
+
+    const DrawQuad* prev = NULL;
+    for (size_t i = 0; i < list->count; i++) {
+        const DrawQuad* q = &list->quads[i];
+
+        if (!prev || q->scissor != prev->scissor) {
+            if (prev && prev->scissor >= 0) EndScissorMode();
+            if (q->scissor >= 0) {
+                Rectangle r = list->scissors[q->scissor];
+                BeginScissorMode(r.x, r.y, r.width, r.height);
+            }
+        }
+        if (!prev || q->raw != prev->raw) {
+            if (q->raw) {
+                font_end();
+            } else if (prev) {
+                font_begin();
+            }
+        }
+        if (!prev || q->texture.id != prev->texture.id ||
+            q->scissor != prev->scissor || q->raw != prev->raw) {
+            list->draw_calls++;
+        }
+
+        DrawTexturePro(q->texture, q->source, q->dest, (Vector2){0, 0}, 0,
+                       q->color);
+        prev = q;
+    }
+
+    if (prev && prev->scissor >= 0) EndScissorMode();
+    if (prev && prev->raw) font_begin();
+
+    list->count = 0;
+    list->scissor_count = 0;
+    list->scissor = -1;
+}
+
+// pointer input
+
+static ImEvent events[im_max_events];
+static size_t event_count;
+
+// per pointer, the widget it went down on and where it is now
+static ImId active[im_max_pointers];
+static bool pointer_down[im_max_pointers];
+static Vector2 pointer_position[im_max_pointers];
+// the raylib touch point id a touch pointer follows
+static int pointer_touch_id[im_max_pointers];
+
+ImId im_id(const char* name, int index) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    return hash + index;
+}
+
+static void queue_event(ImEventType type, int pointer, Vector2 position) {
+    if (event_count == im_max_events) return;
+    events[event_count++] = (ImEvent){
+        .type = type,
+        .pointer = pointer,
+        .position = position,
+    };
+}
+
+// Matches the touch points raylib polled to the touch pointers by id.
+// Points that are gone are lifted first, and new ones then go down, so a
+// pointer freed by one finger can be taken by the next. Returns whether
+// any touch is down.
+static bool poll_touches(void) {
+    int count = GetTouchPointCount();
+    if (count > im_max_pointers - 1) count = im_max_pointers - 1;
+
+    int ids[im_max_pointers];
+    Vector2 positions[im_max_pointers];
+    for (int i = 0; i < count; i++) {
+        ids[i] = GetTouchPointId(i);
+        positions[i] = GetTouchPosition(i);
+    }
+
+    bool matched[im_max_pointers] = {false};
+    for (int p = 1; p < im_max_pointers; p++) {
+        if (!pointer_down[p]) continue;
+        int i = 0;
+        while (i < count && ids[i] != pointer_touch_id[p]) i++;
+        if (i == count) {
+            queue_event(IM_POINTER_UP, p, pointer_position[p]);
+            pointer_down[p] = false;
+        } else {
+            pointer_position[p] = positions[i];
+            matched[i] = true;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (matched[i]) continue;
+        int p = 1;
+        while (pointer_down[p]) p++;
+        pointer_down[p] = true;
+        pointer_touch_id[p] = ids[i];
+        pointer_position[p] = positions[i];
+        queue_event(IM_POINTER_DOWN, p, positions[i]);
+    }
+
+    return count > 0;
+}
+
+// Turns what raylib polled since the last frame into events.
+static void poll_pointers(void) {
+    // raylib also reports the first touch as the mouse, which must not
+    // press a second time, and lifting it is still reported the frame
+    // after the touch is gone
+    static bool touched;
+    bool touching = poll_touches();
+    bool mouse_from_touch = touching || touched;
+    touched = touching;
+
+    if (mouse_from_touch) {
+        pointer_down[0] = false;
+        active[0] = 0;
+        return;
+    }
+
+    Vector2 mouse = GetMousePosition();
+    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        queue_event(IM_POINTER_DOWN, 0, mouse);
+    }
+    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+        queue_event(IM_POINTER_UP, 0, mouse);
+    }
+    pointer_down[0] = IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+    pointer_position[0] = mouse;
+}
+
+// Carries the widgets the presses of this frame landed on to the next one.
+static void settle_pointers(void) {
+    for (size_t i = 0; i < event_count; i++) {
+        const ImEvent* event = &events[i];
+        active[event->pointer] =
+            event->type == IM_POINTER_DOWN ? event->target : 0;
+    }
+    event_count = 0;
+}
+
+const ImEvent* im_events(size_t* count) {
+    *count = event_count;
+    return events;
+}
+
+bool im_active(ImId id) {
+    for (int p = 0; p < im_max_pointers; p++) {
+        if (active[p] == id) return true;
+    }
+    return false;
+}
+
+ImButtonState im_button_state(ImId id, Rectangle rec) {
+    ImButtonState state = {0};
+
+    bool down[im_max_pointers];
+    bool any_down = false;
+    for (int p = 0; p < im_max_pointers; p++) {
+        down[p] = active[p] == id;
+        any_down |= down[p];
+    }
+    if (!any_down && !event_count) return state;
+
+    for (size_t i = 0; i < event_count; i++) {
+        ImEvent* event = &events[i];
+        bool inside = CheckCollisionPointRec(event->position, rec);
+        if (event->type == IM_POINTER_DOWN) {
+            down[event->pointer] = inside;
+            if (inside) event->target = id;
+        } else {
+            if (down[event->pointer] && inside) {
+                event->clicked = id;
+                state.clicks++;
+            }
+            down[event->pointer] = false;
+        }
+    }
+
+    for (int p = 0; p < im_max_pointers; p++) {
+        if (down[p] && pointer_down[p] &&
+            CheckCollisionPointRec(pointer_position[p], rec)) {
+            state.held = true;
+        }
+    }
+    return state;
+}
+
+// text measuring
+
+#define text_cache_size 512
+#define text_cache_max_probe 8
+#define text_cache_max_length 31
+
+typedef struct {
+    uint64_t hash;
+    uint32_t frame;
+    int font_size;
+    int width;
+    char text[text_cache_max_length + 1];
+} TextCacheEntry;
+
+static TextCacheEntry text_cache[text_cache_size];
+static uint32_t text_cache_frame = 1;
+size_t text_cache_hits = 0;
+size_t text_cache_misses = 0;
+
+
+// FNV-1a over the text and then the size.
+static uint64_t text_hash(const char* text, size_t length, int font_size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    hash ^= (uint32_t)font_size;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+int measure_text(const char* text, int font_size) {
+    size_t length = strlen(text);
+    if (length > text_cache_max_length) return MeasureText(text, font_size);
+
+    uint64_t hash = text_hash(text, length, font_size);
+    TextCacheEntry* slot = NULL;
+
+    for (size_t probe = 0; probe < text_cache_max_probe; probe++) {
+        TextCacheEntry* e = &text_cache[(hash + probe) % text_cache_size];
+        if (e->frame && e->hash == hash && e->font_size == font_size &&
+            strcmp(e->text, text) == 0) {
+            e->frame = text_cache_frame;
+            text_cache_hits++;
+            return e->width;
+        }
+        // entries carry the frame they were last used in, a miss replaces
+        // the oldest one in reach, or an empty one
+        if (!slot || slot->frame > e->frame) slot = e;
+    }
+
+    text_cache_misses++;
+    slot->hash = hash;
+    slot->frame = text_cache_frame;
+    slot->font_size = font_size;
+    slot->width = MeasureText(text, font_size);
+    memcpy(slot->text, text, length + 1);
+    return slot->width;
+}
+
+void im_begin_frame(void) {
+    text_cache_frame++;
+    draw_list.draw_calls = 0;
+    poll_pointers();
+}
+
+void im_end_frame(void) {
+    im_flush();
+    im_frame_draw_calls = draw_list.draw_calls;
+    settle_pointers();
+}
+
 static void draw_centered_text(const char* text, Vector2 point, int size,
                                Color color) {
-    int tw = MeasureText(text, size);
-    DrawText(text, point.x - tw / 2.f, point.y - size / 2.f, size, color);
+    int tw = measure_text(text, size);
+    draw_text(text, point.x - tw / 2.f, point.y - size / 2.f, size, color);
+}
+
+void im_draw_button(Rectangle rec, const char* text, Color bg, Color fg) {
+    im_rect(rec, bg);
+    draw_centered_text(text, get_rect_center(rec), gui_font_size, fg);
 }
 
-bool im_button(Rectangle rec, const char* text) {
+bool im_button(ImId id, Rectangle rec, const char* text) {
+    ImButtonState state = im_button_state(id, rec);
+
     Color bg_color = color_palette[button_normal_color];
     Color fg_color = color_palette[button_pressed_color];
-    bool colliding = false;
-    if (CheckCollisionPointRec(GetMousePosition(), rec)) {
-        colliding = true;
-    }
-    if (colliding && IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+    if (state.held) {
         bg_color = color_palette[button_pressed_color];
         fg_color = color_palette[button_normal_color];
     }
-    DrawRectangleRec(rec, bg_color);
+    im_draw_button(rec, text, bg_color, fg_color);
 
-    Vector2 center = get_rect_center(rec);
+    return state.clicks > 0;
+}
+
+static const int default_font_size = 10;
 
-    draw_centered_text(text, center, gui_font_size, fg_color);
+float text_spacing(int font_size) {
+    if (font_size < default_font_size) font_size = default_font_size;
+    return font_size / default_font_size;
+}
 
-    return colliding && IsMouseButtonReleased(MOUSE_BUTTON_LEFT);
+float glyph_width(int codepoint, int font_size) {
+    if (font_size < default_font_size) font_size = default_font_size;
+    Font font = GetFontDefault();
+    int index = GetGlyphIndex(font, codepoint);
+    float scale = (float)font_size / font.baseSize;
+    if (font.glyphs[index].advanceX) return font.glyphs[index].advanceX * scale;
+    return (font.recs[index].width + font.glyphs[index].offsetX) * scale;
 }
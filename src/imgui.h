@@ -3,6 +3,7 @@
 
 #include <raylib.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #define COLOR_RGB(c)                  \
     ((Color){.r = ((c) >> 16) & 0xff, \
@@ -29,6 +30,101 @@ Rectangle split_rect_grid(Rectangle container, int gw, int gh, int row,
 
 Rectangle margin_rect(Rectangle container, int margin);
 
-bool im_button(Rectangle rec, const char* text);
+// Widgets are told apart across frames by an ID made from a name, and an
+// index for widgets made in a loop.
+typedef uint32_t ImId;
+
+ImId im_id(const char* name, int index);
+
+// Pointer 0 is the mouse, the others are touches, each from the moment a
+// finger goes down until it is lifted. Both come from the state raylib polls
+// once a frame, so a tap that goes down and up between two polls is never
+// seen and can not click anything.
+#define im_max_pointers 10
+#define im_max_events 64
+
+typedef enum {
+    IM_POINTER_DOWN,
+    IM_POINTER_UP,
+} ImEventType;
+
+// A press or release of a pointer, queued by im_begin_frame in the order
+// they happened. target is the widget a press landed on, clicked the one a
+// release completed a click on, or 0.
+typedef struct {
+    ImEventType type;
+    int pointer;
+    Vector2 position;
+    ImId target;
+    ImId clicked;
+} ImEvent;
+
+const ImEvent* im_events(size_t* count);
+
+// Whether a pointer that went down on the widget is still holding it.
+bool im_active(ImId id);
+
+typedef struct {
+    // pressed and the pointer still over it
+    bool held;
+    // presses and releases both on the widget during this frame
+    int clicks;
+} ImButtonState;
+
+// Goes through the queued events for a button, for callers drawing it
+// themselves. A button is only clicked when the pointer is released over
+// the same button it went down on.
+ImButtonState im_button_state(ImId id, Rectangle rec);
+
+bool im_button(ImId id, Rectangle rec, const char* text);
+
+void im_draw_button(Rectangle rec, const char* text, Color bg, Color fg);
+
+// Drawing goes into a list of textured quads, drawn by im_flush in the
+// order they were added. Consecutive quads with the same texture, scissor
+// rectangle and shader become one draw call, and since rectangles and text
+// share the font texture most of a frame is a single one.
+
+void im_rect(Rectangle rec, Color color);
+
+// Like DrawText and DrawTextEx with the default font, with the same metrics.
+void draw_text(const char* text, float x, float y, int font_size, Color color);
+
+void draw_text_ex(const char* text, Vector2 position, float font_size,
+                  float spacing, Color color);
+
+// A texture holding colors rather than distances, drawn without the font
+// shader.
+void im_texture(Texture2D texture, Rectangle source, Rectangle dest);
+
+// Clips what is added until im_scissor_end.
+void im_scissor_begin(Rectangle rec);
+
+void im_scissor_end(void);
+
+// Draws and empties the list.
+void im_flush(void);
+
+// Draw calls made for the last complete frame.
+extern size_t im_frame_draw_calls;
+
+// MeasureText with the results of recently measured short texts cached, by
+// text and size. Entries age by frames.
+int measure_text(const char* text, int font_size);
+
+// Call around everything drawn in a frame. im_begin_frame queues the input
+// events, im_end_frame flushes the draw list.
+void im_begin_frame(void);
+
+void im_end_frame(void);
+
+extern size_t text_cache_hits;
+extern size_t text_cache_misses;
+
+// Horizontal metrics of the default font, matching what MeasureText and
+// DrawText use, so callers can lay out text one glyph at a time.
+float text_spacing(int font_size);
+
+float glyph_width(int codepoint, int font_size);
 
 #endif  // IMGUI_H_
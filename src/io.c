@@ -0,0 +1,283 @@
+#define _GNU_SOURCE
+
+#include "io.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <raylib.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __ANDROID__
+#include <android_native_app_glue.h>
+
+struct android_app* GetAndroidApp(void);
+#endif
+
+// import
+
+#define import_max_threads 8
+#define import_min_chunk_size (1 << 20)
+
+static bool is_separator(char c) {
+    return c == '\n' || c == '\r' || c == ',' || c == ';' || c == ' ' ||
+           c == '\t';
+}
+
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Whether the field starting at it holds a number, both passes over a chunk
+// have to agree on this for the counts to match.
+static bool field_is_number(const char* it, const char* end) {
+    if (it != end && (*it == '-' || *it == '+')) it++;
+    if (it != end && *it == '.') it++;
+    return it != end && is_digit(*it);
+}
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    size_t count;
+    Number* out;
+} ImportChunk;
+
+static void* import_count_chunk(void* arg) {
+    ImportChunk* chunk = arg;
+    const char* it = chunk->begin;
+    size_t count = 0;
+
+    while (it != chunk->end) {
+        if (is_separator(*it)) {
+            it++;
+            continue;
+        }
+        if (field_is_number(it, chunk->end)) count++;
+        while (it != chunk->end && !is_separator(*it)) it++;
+    }
+
+    chunk->count = count;
+    return NULL;
+}
+
+static void* import_parse_chunk(void* arg) {
+    ImportChunk* chunk = arg;
+    const char* it = chunk->begin;
+    Number* out = chunk->out;
+
+    while (it != chunk->end) {
+        if (is_separator(*it)) {
+            it++;
+            continue;
+        }
+        if (field_is_number(it, chunk->end)) {
+            bool negative = *it == '-';
+            if (*it == '-' || *it == '+') it++;
+            *out++ = number_parse(&it, chunk->end, negative);
+        }
+        while (it != chunk->end && !is_separator(*it)) it++;
+    }
+
+    return NULL;
+}
+
+static void import_run(ImportChunk* chunks, size_t n, void* (*f)(void*)) {
+    pthread_t threads[import_max_threads];
+    size_t started = 1;
+
+    for (; started < n; started++) {
+        if (pthread_create(&threads[started], NULL, f, &chunks[started])) {
+            break;
+        }
+    }
+    // whatever could not get a thread runs here
+    for (size_t i = started; i < n; i++) f(&chunks[i]);
+    f(&chunks[0]);
+
+    for (size_t i = 1; i < started; i++) pthread_join(threads[i], NULL);
+}
+
+bool stack_import_file(Stack* stack, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+
+    const char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+
+    size_t n = size / import_min_chunk_size;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && n > (size_t)cpus) n = cpus;
+    if (n > import_max_threads) n = import_max_threads;
+    if (n == 0) n = 1;
+
+    // chunks are split right after a newline so no field is cut in two
+    ImportChunk chunks[import_max_threads];
+    const char* end = data + size;
+    const char* it = data;
+    for (size_t i = 0; i < n; i++) {
+        chunks[i].begin = it;
+        it = i + 1 == n ? end : data + size / n * (i + 1);
+        if (it < chunks[i].begin) it = chunks[i].begin;
+        while (it != end && *it != '\n') it++;
+        if (it != end) it++;
+        chunks[i].end = it;
+    }
+
+    import_run(chunks, n, import_count_chunk);
+
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) total += chunks[i].count;
+
+    if (!stack_reserve(stack, stack->count + total)) {
+        munmap((void*)data, size);
+        return false;
+    }
+
+    Number* out = stack->items + stack->count;
+    for (size_t i = 0; i < n; i++) {
+        chunks[i].out = out;
+        out += chunks[i].count;
+    }
+
+    import_run(chunks, n, import_parse_chunk);
+
+    size_t begin = stack->count;
+    stack_touch(stack, begin);
+    stack->count += total;
+    stack_invalidate_stats(stack);
+
+    // past the memory budget only the top stays hot
+    if (stack_memory_budget &&
+        stack->count * sizeof(Number) > stack_memory_budget) {
+        stack_release_items(stack, begin, stack->count);
+        if (stack->count) stack_touch(stack, stack->count - 1);
+    }
+
+    munmap((void*)data, size);
+    return true;
+}
+
+// export
+
+#define export_buffer_size (1 << 20)
+
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t used;
+    bool failed;
+} ExportWriter;
+
+static void export_write(ExportWriter* w, const void* data, size_t size) {
+    const char* it = data;
+    while (size && !w->failed) {
+        ssize_t n = write(w->fd, it, size);
+        if (n < 0) {
+            w->failed = true;
+        } else {
+            it += n;
+            size -= n;
+        }
+    }
+}
+
+static void export_flush(ExportWriter* w) {
+    export_write(w, w->buffer, w->used);
+    w->used = 0;
+}
+
+bool stack_export_file(Stack* stack, size_t begin, size_t end,
+                       const char* path, ExportFormat format) {
+    ExportWriter w = {0};
+    w.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w.fd < 0) return false;
+
+    if (format == EXPORT_BINARY) {
+        // already in its final form, no need to go through the buffer
+        const size_t step = export_buffer_size / sizeof(Number);
+        for (size_t i = begin; i < end; i += step) {
+            size_t n = end - i < step ? end - i : step;
+            export_write(&w, &stack->items[i], n * sizeof(Number));
+        }
+    } else {
+        w.buffer = malloc(export_buffer_size);
+        char separator = format == EXPORT_CSV ? ',' : '\n';
+
+        for (size_t i = begin; i < end; i++) {
+            if (w.used + number_format_max > export_buffer_size) {
+                export_flush(&w);
+            }
+            w.used += number_format(stack->items[i], &w.buffer[w.used]);
+            w.buffer[w.used++] = i + 1 == end ? '\n' : separator;
+        }
+        export_flush(&w);
+
+        free(w.buffer);
+    }
+
+    if (close(w.fd) < 0) w.failed = true;
+    return !w.failed;
+}
+
+char* stack_export_text(Stack* stack, size_t begin, size_t end) {
+    if (stack_memory_budget &&
+        end - begin > stack_memory_budget / number_format_max) {
+        return NULL;
+    }
+
+    char* text = malloc((end - begin) * number_format_max + 1);
+    if (!text) return NULL;
+    size_t used = 0;
+
+    for (size_t i = begin; i < end; i++) {
+        used += number_format(stack->items[i], &text[used]);
+        text[used++] = '\n';
+    }
+    text[used] = '\0';
+
+    return text;
+}
+
+const char* user_file_path(const char* name) {
+#ifdef __ANDROID__
+    return TextFormat("%s/%s", GetAndroidApp()->activity->externalDataPath,
+                      name);
+#else
+    return name;
+#endif
+}
+
+const char* app_file_path(const char* name) {
+#ifdef __ANDROID__
+    return TextFormat("%s/%s", GetAndroidApp()->activity->internalDataPath,
+                      name);
+#else
+    const char* home = getenv("HOME");
+    if (!home) return name;
+    return TextFormat("%s/.%s", home, name);
+#endif
+}
+
+const char* temp_directory(void) {
+#ifdef __ANDROID__
+    return GetAndroidApp()->activity->internalDataPath;
+#else
+    const char* dir = getenv("TMPDIR");
+    return dir ? dir : "/tmp";
+#endif
+}
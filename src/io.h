@@ -0,0 +1,43 @@
+#ifndef IO_H_
+#define IO_H_
+
+#include "stack.h"
+
+// Pushes every number found in the file onto the stack. Numbers may be
+// separated by newlines, commas, semicolons or whitespace, fields that do not
+// start like a number (e.g. CSV headers) are skipped. Large files are parsed
+// by several threads. Returns false if the file could not be read.
+bool stack_import_file(Stack* stack, const char* path);
+
+typedef enum {
+    EXPORT_LINES,
+    EXPORT_CSV,
+    EXPORT_BINARY,
+} ExportFormat;
+
+// Writes items [begin, end) of the stack to the file, one number per line,
+// comma separated, or as raw native endian int64 records. Text is formatted
+// into a fixed buffer that is written out a megabyte at a time, so nothing
+// the size of the stack is ever allocated.
+bool stack_export_file(Stack* stack, size_t begin, size_t end,
+                       const char* path, ExportFormat format);
+
+// Formats items [begin, end) one per line into a newly allocated string for
+// the clipboard. The caller frees it. The text is larger than the items, so
+// this returns NULL for more items than fit in a nonzero stack_memory_budget
+// as text, or when it can not be allocated.
+char* stack_export_text(Stack* stack, size_t begin, size_t end);
+
+// Path of a file the user can get to: the working directory on desktop, the
+// app's external files directory on Android.
+const char* user_file_path(const char* name);
+
+// Path of a file private to the app: in the home directory on desktop, the
+// app's internal files directory on Android.
+const char* app_file_path(const char* name);
+
+// Directory for scratch files: $TMPDIR or /tmp on desktop, the app's internal
+// files directory on Android.
+const char* temp_directory(void);
+
+#endif  // IO_H_
@@ -1,283 +1,307 @@
 #include <assert.h>
-#include <errno.h>
 #include <limits.h>
 #include <math.h>
 #include <raylib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "font.h"
+#include "histogram.h"
+#include "history.h"
 #include "imgui.h"
+#include "io.h"
+#include "number.h"
+#include "registers.h"
+#include "regression.h"
+#include "session.h"
+#include "stack.h"
 
-// number
-
-typedef int64_t Number;
-
-const int number_decimal_digits = 6;
-const int64_t number_scaling_factor = 1000000;
-
-Number number_handle_overflow(__int128_t t) {
-    if (t > LLONG_MAX) return LLONG_MAX;
-    if (t < LLONG_MIN) return LLONG_MIN;
-    return t;
-}
-
-Number number_add(Number a, Number b) {
-    __int128_t ta = a;
-    __int128_t tb = b;
-    return ta + tb;
-}
-
-Number number_sub(Number a, Number b) {
-    __int128_t ta = a;
-    __int128_t tb = b;
-    return ta - tb;
-}
-
-Number number_mul(Number a, Number b) {
-    __int128_t ta = a;
-    __int128_t tb = b;
-    return number_handle_overflow((ta * tb) / number_scaling_factor);
-}
+// text buffer
 
-Number number_div(Number a, Number b) {
-    if (b == 0) return a > 0 ? LLONG_MAX : LLONG_MIN;
-    __int128_t ta = a;
-    __int128_t tb = b;
-    return number_handle_overflow(ta * number_scaling_factor / tb);
-}
+// The text lives in a gap buffer. The bytes before the gap and the bytes after
+// it are both kept NUL-terminated, so either half can be handed to raylib as
+// is. The gap only follows the cursor when an edit happens.
 
-Number number_root(Number x, int base) {
-    if (x == LLONG_MAX) return LLONG_MAX;
-    if (x == LLONG_MIN) return LLONG_MIN;
+#define text_buffer_initial_capacity 32
 
-    __int128_t l = 0, r = x;
-    while (l != r) {
-        Number c = ((__int128_t)l + (__int128_t)r + 1) / 2;
-        Number a = number_scaling_factor;
-        for (size_t i = 0; i < base; i++) {
-            a = number_mul(a, c);
-        }
-        if (a > x) {
-            r = c - 1;
-        } else {
-            l = c;
-        }
-    }
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t gap_start;
+    size_t gap_end;
+    size_t count;
+    size_t cursor;
+    bool period_present;
+    int period_position;
+    bool negative;
+    double last_edit_time;
+
+    // layout cache, rebuilt by draw_text_buffer after an edit
+    float* prefix_widths;
+    size_t prefix_capacity;
+    int font_size;
+    float layout_width;
+    bool layout_dirty;
+} TextBuffer;
 
-    return l;
+static char text_buffer_at(TextBuffer* tb, size_t i) {
+    return i < tb->gap_start ? tb->data[i]
+                             : tb->data[i + tb->gap_end - tb->gap_start];
 }
 
-Number number_pow_i(Number x, int e) {
-    Number acc = number_scaling_factor;
-    Number p2 = x;
-
-    while (e) {
-        if (e & 1) acc = number_mul(acc, p2);
-        e >>= 1;
-        p2 = number_mul(p2, p2);
+static void text_buffer_move_gap(TextBuffer* tb, size_t position) {
+    if (!tb->data) return;
+    if (position < tb->gap_start) {
+        size_t n = tb->gap_start - position;
+        memmove(&tb->data[tb->gap_end - n], &tb->data[position], n);
+        tb->gap_start -= n;
+        tb->gap_end -= n;
+    } else if (position > tb->gap_start) {
+        size_t n = position - tb->gap_start;
+        memmove(&tb->data[tb->gap_start], &tb->data[tb->gap_end], n);
+        tb->gap_start += n;
+        tb->gap_end += n;
     }
-
-    return acc;
+    tb->data[tb->gap_start] = '\0';
 }
 
-Number number_pow(Number x, Number y) {
-    if (y < 0) {
-        return number_pow(number_div(number_scaling_factor, x), -y);
+static void text_buffer_insert(TextBuffer* tb, char c) {
+    text_buffer_move_gap(tb, tb->cursor);
+
+    // one byte of the gap is always kept for the terminator
+    if (tb->gap_end - tb->gap_start < 2) {
+        size_t capacity = tb->capacity ? tb->capacity * 2
+                                       : text_buffer_initial_capacity;
+        size_t tail = tb->capacity - tb->gap_end;
+        tb->data = realloc(tb->data, capacity + 1);
+        memmove(&tb->data[capacity - tail], &tb->data[tb->gap_end], tail);
+        tb->data[capacity] = '\0';
+        tb->gap_end = capacity - tail;
+        tb->capacity = capacity;
     }
 
-    Number acc = number_pow_i(x, y / number_scaling_factor);
-
-    if (x > 0) {
-        uint64_t mantisa = y % number_scaling_factor;
-
-        Number digs[number_decimal_digits];
-        digs[0] = number_root(x, 10);
-        for (size_t i = 1; i < number_decimal_digits; i++) {
-            digs[i] = number_root(digs[i - 1], 10);
-        }
-
-        for (int i = number_decimal_digits - 1; i >= 0; i--) {
-            size_t d = mantisa % 10;
-            mantisa /= 10;
-            Number a = number_scaling_factor;
-            for (size_t j = 0; j < d; j++) {
-                a = number_mul(a, digs[i]);
-            }
-            acc = number_mul(acc, a);
-        }
+    if (tb->period_present && tb->period_position >= tb->cursor) {
+        tb->period_position++;
     }
 
-    return acc;
+    tb->data[tb->gap_start++] = c;
+    tb->data[tb->gap_start] = '\0';
+    tb->cursor++;
+    tb->count++;
+    tb->layout_dirty = true;
+    tb->last_edit_time = GetTime();
 }
 
-// text buffer
-
-#define max_text_buffer_size 18
-
-typedef struct {
-    char buffer[max_text_buffer_size + 1];
-    size_t count;
-    size_t cursor;
-    bool period_present;
-    int period_position;
-    bool negative;
-    float last_edit_time;
-} TextBuffer;
-
 void text_buffer_append_digit(TextBuffer* tb, int digit) {
     assert(digit >= 0 && digit <= 9);
-    if (tb->count >= max_text_buffer_size) return;
-
-    if (tb->cursor < tb->count) {
-        memmove(&tb->buffer[tb->cursor + 1], &tb->buffer[tb->cursor],
-                max_text_buffer_size - tb->cursor);
-    }
-    tb->buffer[tb->cursor++] = '0' + digit;
-    tb->count++;
-    tb->last_edit_time = GetTime();
+    text_buffer_insert(tb, '0' + digit);
 }
 
 void text_buffer_append_period(TextBuffer* tb) {
     if (tb->period_present) return;
-    if (tb->count >= max_text_buffer_size) return;
 
-    if (tb->cursor < tb->count) {
-        memmove(&tb->buffer[tb->cursor + 1], &tb->buffer[tb->cursor],
-                max_text_buffer_size - tb->cursor);
-    }
+    text_buffer_insert(tb, '.');
     tb->period_present = true;
-    tb->period_position = tb->cursor;
-    tb->buffer[tb->cursor++] = '.';
-    tb->count++;
-    tb->last_edit_time = GetTime();
+    tb->period_position = tb->cursor - 1;
 }
 
 void text_buffer_backspace(TextBuffer* tb) {
     if (tb->cursor == 0) return;
-    if (tb->buffer[tb->cursor - 1] == '.') {
+    text_buffer_move_gap(tb, tb->cursor);
+
+    tb->gap_start--;
+    if (tb->data[tb->gap_start] == '.') {
         tb->period_present = false;
+    } else if (tb->period_present && tb->period_position >= tb->cursor) {
+        tb->period_position--;
     }
-    if (tb->cursor != tb->count) {
-        memmove(&tb->buffer[tb->cursor - 1], &tb->buffer[tb->cursor],
-                max_text_buffer_size - tb->cursor);
-    }
+    tb->data[tb->gap_start] = '\0';
     tb->cursor--;
     tb->count--;
-    tb->buffer[tb->count] = '\0';
+    tb->layout_dirty = true;
     tb->last_edit_time = GetTime();
 }
 
 void text_toggle_negative(TextBuffer* tb) { tb->negative = !tb->negative; }
 
-void text_buffer_clear(TextBuffer* tb) { memset(tb, 0, sizeof(TextBuffer)); }
+void text_buffer_clear(TextBuffer* tb) {
+    tb->gap_start = 0;
+    tb->gap_end = tb->capacity;
+    if (tb->data) tb->data[0] = '\0';
+    tb->count = 0;
+    tb->cursor = 0;
+    tb->period_present = false;
+    tb->period_position = 0;
+    tb->negative = false;
+    tb->last_edit_time = 0;
+    tb->layout_dirty = true;
+}
+
+void text_buffer_free(TextBuffer* tb) {
+    free(tb->data);
+    free(tb->prefix_widths);
+    memset(tb, 0, sizeof(TextBuffer));
+}
+
+// Replaces the contents with text made of digits and at most one period.
+void text_buffer_set(TextBuffer* tb, const char* text, size_t length,
+                     bool negative) {
+    text_buffer_clear(tb);
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '.')
+            text_buffer_append_period(tb);
+        else if (text[i] >= '0' && text[i] <= '9')
+            text_buffer_append_digit(tb, text[i] - '0');
+    }
+    tb->negative = negative;
+}
+
+// Contents as a single string.
+const char* text_buffer_text(TextBuffer* tb) {
+    if (!tb->data) return "";
+    text_buffer_move_gap(tb, tb->count);
+    return tb->data;
+}
 
 Number text_buffer_get(TextBuffer* tb) {
-    char* end;
-    Number out = strtoll(tb->buffer, &end, 10);
-    if (errno == ERANGE) {
-        if (!tb->negative)
-            return LLONG_MAX;
-        else
-            return LLONG_MIN;
+    if (!tb->count) return 0;
+
+    text_buffer_move_gap(tb, tb->count);
+
+    const char* it = tb->data;
+    return number_parse(&it, tb->data + tb->count, tb->negative);
+}
+
+// Fills prefix_widths so that entry i is the width MeasureText would report
+// for the first i characters, shrinking the font until the text fits.
+static void text_buffer_layout(TextBuffer* tb, int font_size, float width) {
+    if (!tb->layout_dirty && tb->layout_width == width) return;
+
+    if (tb->prefix_capacity < tb->count + 1) {
+        tb->prefix_capacity = (tb->count + 1) * 2;
+        tb->prefix_widths =
+            realloc(tb->prefix_widths, tb->prefix_capacity * sizeof(float));
     }
-    if ((__int128_t)out * (__int128_t)number_scaling_factor > LLONG_MAX)
-        return LLONG_MAX;
 
-    out *= number_scaling_factor;
+    const int min_font_size = gui_font_size / 2;
 
-    if (end != tb->buffer + tb->count) {
-        if (*end == '.') {
-            char* begin = ++end;
+    for (;;) {
+        float spacing = text_spacing(font_size);
+        float w = 0;
+        tb->prefix_widths[0] = 0;
+        for (size_t i = 0; i < tb->count; i++) {
+            w += glyph_width(text_buffer_at(tb, i), font_size);
+            tb->prefix_widths[i + 1] = w + i * spacing;
+        }
 
-            Number mantisa = 0;
+        w = tb->prefix_widths[tb->count];
+        if (w + font_size <= width || font_size == min_font_size) break;
 
-            while (*end && (end - begin + 1) <= number_decimal_digits) {
-                mantisa *= 10;
-                mantisa += *end - '0';
-                end++;
-            }
+        font_size *= width / (w + font_size);
+        if (font_size < min_font_size) font_size = min_font_size;
+    }
 
-            for (int i = number_decimal_digits - (end - begin); i > 0; i--) {
-                mantisa *= 10;
-            }
+    tb->font_size = font_size;
+    tb->layout_width = width;
+    tb->layout_dirty = false;
+}
 
-            out += mantisa;
+// Caret position closest to x, measured from the start of the text. The
+// prefix widths only grow, so a binary search finds the first one past x
+// and the caret is either there or just before it.
+size_t text_buffer_caret_at(TextBuffer* tb, float x) {
+    size_t lo = 0;
+    size_t hi = tb->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tb->prefix_widths[mid] < x) {
+            lo = mid + 1;
         } else {
-            assert(false && "Unreachable");
+            hi = mid;
         }
     }
+    if (lo > 0 && x - tb->prefix_widths[lo - 1] <= tb->prefix_widths[lo] - x) {
+        lo--;
+    }
+    return lo;
+}
 
-    if (tb->negative) out *= -1;
+#define cursor_blink_interval 0.5
+// after this long without an edit the cursor stays on, so an idle app has
+// nothing left to redraw
+#define cursor_blink_duration 10.0
 
-    return out;
+bool text_buffer_cursor_visible(TextBuffer* tb, double now) {
+    double t = now - tb->last_edit_time;
+    return t >= cursor_blink_duration ||
+           !((int)(t / cursor_blink_interval) & 1);
+}
+
+// Time the cursor next turns on or off, INFINITY once it stopped blinking.
+double text_buffer_next_blink(TextBuffer* tb, double now) {
+    double t = now - tb->last_edit_time;
+    if (t >= cursor_blink_duration) return INFINITY;
+    return tb->last_edit_time +
+           (floor(t / cursor_blink_interval) + 1) * cursor_blink_interval;
 }
 
 void draw_text_buffer(Rectangle container, TextBuffer* tb) {
-    DrawRectangleRec(container, color_palette[1]);
+    im_rect(container, color_palette[1]);
 
+    Rectangle clip = container;
     container = margin_rect(container, 8);
 
-    int font_size = gui_font_size * 2;
+    text_buffer_layout(tb, gui_font_size * 2, container.width);
 
-    int w = MeasureText(tb->buffer, font_size);
+    int font_size = tb->font_size;
+    float spacing = text_spacing(font_size);
+    float w = tb->prefix_widths[tb->count];
 
-    if (w + font_size > container.width) {
-        float t = container.width / (w + font_size);
-        font_size *= t;
-        w *= t;
+    // right aligned, unless the text overflows and the cursor would be hidden
+    float x = container.x + container.width - w;
+    if (x + tb->prefix_widths[tb->cursor] < container.x) {
+        x = container.x - tb->prefix_widths[tb->cursor];
+    }
+    float y = container.y + (container.height - font_size) / 2;
+
+    bool overflow = w + font_size > container.width;
+    if (overflow) {
+        im_scissor_begin(clip);
     }
 
     Vector2 mouse = GetMousePosition();
 
     if (CheckCollisionPointRec(mouse, container) &&
         IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
-        float mx = mouse.x - (container.x + container.width - w);
-
-        size_t b;
-        float bd = INFINITY;
-
-        for (size_t i = 0; i <= tb->count; i++) {
-            char temp = tb->buffer[i];
-            tb->buffer[i] = '\0';
-            float tw = MeasureText(tb->buffer, font_size);
-            float d = fabsf(tw - mx);
-            if (d < bd) {
-                b = i;
-                bd = d;
-            }
-            tb->buffer[i] = temp;
-        }
-
-        tb->cursor = b;
+        tb->cursor = text_buffer_caret_at(tb, mouse.x - x);
     }
 
-    DrawText(tb->buffer, container.x + container.width - w,
-             container.y + (container.height - font_size) / 2, font_size,
-             color_palette[3]);
+    if (tb->data) {
+        Vector2 position = {x, y};
+        draw_text_ex(tb->data, position, font_size, spacing, color_palette[3]);
+        position.x += tb->prefix_widths[tb->gap_start];
+        if (tb->gap_start) position.x += spacing;
+        draw_text_ex(&tb->data[tb->gap_end], position, font_size, spacing,
+                     color_palette[3]);
+    }
 
     if (tb->negative) {
-        DrawText("-", container.x + container.width - w - font_size * 0.5f,
-                 container.y + (container.height - font_size) / 2, font_size,
-                 color_palette[4]);
+        draw_text("-", x - font_size * 0.5f, y, font_size, color_palette[4]);
     }
 
-    if (!((int)((GetTime() - tb->last_edit_time) / 0.5) & 1)) {
-        char temp = tb->buffer[tb->cursor];
-
-        tb->buffer[tb->cursor] = '\0';
-
-        int ox = MeasureText(tb->buffer, font_size);
+    if (text_buffer_cursor_visible(tb, GetTime())) {
+        int ox = tb->prefix_widths[tb->cursor];
 
         const int cursor_width = 2;
 
-        DrawRectangle(container.x + container.width - w + ox + cursor_width,
-                      container.y + (container.height - font_size) / 2,
-                      cursor_width, font_size, color_palette[4]);
-
-        tb->buffer[tb->cursor] = temp;
+        im_rect((Rectangle){x + ox + cursor_width, y, cursor_width, font_size},
+                color_palette[4]);
     }
+
+    if (overflow) im_scissor_end();
 }
 
 // keyboard
@@ -306,229 +330,755 @@ typedef enum {
     TOGGLE_SIGN,
     POP_TO_BUFFER,
     SWAP,
+    EXPORT,
+    COPY,
+    UNDO,
+    REDO,
+    NEXT_PAGE,
+    DUP,
+    DROP,
+    OVER,
+    ROT,
+    PICK,
+    ROLL,
+    CLEAR,
+    DEPTH,
+    SORT,
+    UNIQUE,
+    MEDIAN,
+    PERCENTILE,
+    HISTOGRAM,
+    REGISTERS,
+    LINEAR_REGRESSION,
+    CORRELATION,
+    EXPORT_FORMAT,
 } KeyboardButton;
 
-KeyboardButton draw_keyboard(Rectangle container) {
-    int gw = 4;
-    int gh = 6;
+// Keys in the two rows under undo and redo change with the page.
+typedef struct {
+    int row;
+    int col;
+    const char* label;
+    KeyboardButton button;
+} KeypadKey;
 
-    DrawRectangleRec(container, color_palette[0]);
+#define keyboard_page_count 3
+#define keyboard_page_size 8
 
+static const KeypadKey keyboard_pages[keyboard_page_count]
+                                       [keyboard_page_size] = {
+    {
+        {1, 0, "exp", EXPORT},
+        {1, 1, "copy", COPY},
+        {1, 2, "sqrt", SQRT},
+        {1, 3, "pow", POW},
+        {2, 0, "swap", SWAP},
+        {2, 1, "pop", POP_TO_BUFFER},
+        {2, 2, "+/-", TOGGLE_SIGN},
+        {2, 3, "/", DIV},
+    },
+    {
+        {1, 0, "dup", DUP},
+        {1, 1, "drop", DROP},
+        {1, 2, "over", OVER},
+        {1, 3, "rot", ROT},
+        {2, 0, "pick", PICK},
+        {2, 1, "roll", ROLL},
+        {2, 2, "clear", CLEAR},
+        {2, 3, "depth", DEPTH},
+    },
+    {
+        {1, 0, "sort", SORT},
+        {1, 1, "uniq", UNIQUE},
+        {1, 2, "med", MEDIAN},
+        {1, 3, "pct", PERCENTILE},
+        {2, 0, "hist", HISTOGRAM},
+        {2, 1, "linreg", LINEAR_REGRESSION},
+        {2, 2, "corr", CORRELATION},
+        {2, 3, "txt", EXPORT_FORMAT},
+    },
+};
+
+static const KeypadKey keyboard_digit_keys[] = {
+    {6, 0, "0", DIGIT0}, {5, 0, "1", DIGIT1}, {5, 1, "2", DIGIT2},
+    {5, 2, "3", DIGIT3}, {4, 0, "4", DIGIT4}, {4, 1, "5", DIGIT5},
+    {4, 2, "6", DIGIT6}, {3, 0, "7", DIGIT7}, {3, 1, "8", DIGIT8},
+    {3, 2, "9", DIGIT9},
+};
+
+static const KeypadKey keyboard_fixed_keys[] = {
+    {6, 1, ".", PERIOD},     {6, 2, "del", BACKSPACE}, {6, 3, "push", PUSH},
+    {5, 3, "+", ADD},        {4, 3, "-", SUB},         {3, 3, "*", MUL},
+    {0, 0, "undo", UNDO},    {0, 1, "redo", REDO},     {0, 2, "reg", REGISTERS},
+};
+
+// The export format key shows the format exp writes, which picks the file
+// name as well.
+#define export_format_count 3
+
+static const char* const export_format_labels[export_format_count] = {
+    [EXPORT_LINES] = "txt",
+    [EXPORT_CSV] = "csv",
+    [EXPORT_BINARY] = "bin",
+};
+
+static const char* const export_file_names[export_format_count] = {
+    [EXPORT_LINES] = "rcalc-export.txt",
+    [EXPORT_CSV] = "rcalc-export.csv",
+    [EXPORT_BINARY] = "rcalc-export.bin",
+};
+
+#define keypad_max_buttons 32
+#define keypad_columns 4
+#define keypad_rows 7
+
+// A key placed on screen, with its colors as indices into color_palette.
+typedef struct {
+    Rectangle rect;
+    const char* label;
+    KeyboardButton button;
+    size_t normal_color;
+    size_t pressed_color;
+} KeypadButton;
+
+// The keys of every page placed inside container, and for each grid cell
+// the index of the key in it or -1, so a point is looked up rather than
+// tested against every key.
+typedef struct {
+    Rectangle container;
+    Rectangle grid;
+    KeypadButton buttons[keyboard_page_count][keypad_max_buttons];
+    size_t counts[keyboard_page_count];
+    signed char cells[keyboard_page_count][keypad_rows][keypad_columns];
+    ExportFormat export_format;
+} KeypadLayout;
+
+static void keypad_place(KeypadLayout* layout, int page,
+                         const KeypadKey* keys, size_t key_count,
+                         size_t normal_color, size_t pressed_color) {
     const int button_margin = 2;
 
-    container = margin_rect(container, button_margin);
+    for (size_t i = 0; i < key_count; i++) {
+        if (keys[i].button == NONE) continue;
+        size_t index = layout->counts[page]++;
+        layout->buttons[page][index] = (KeypadButton){
+            .rect = margin_rect(split_rect_grid(layout->grid, keypad_columns,
+                                                keypad_rows, keys[i].row,
+                                                keys[i].col),
+                                button_margin),
+            .label = keys[i].label,
+            .button = keys[i].button,
+            .normal_color = normal_color,
+            .pressed_color = pressed_color,
+        };
+        layout->cells[page][keys[i].row][keys[i].col] = index;
+    }
+}
 
-    KeyboardButton pressed_button = NONE;
+// Places the keys of every page inside container.
+static void keypad_layout(KeypadLayout* layout, Rectangle container,
+                          ExportFormat export_format) {
+    layout->container = container;
+    layout->export_format = export_format;
+    layout->grid = margin_rect(container, 2);
+    memset(layout->counts, 0, sizeof(layout->counts));
+    memset(layout->cells, -1, sizeof(layout->cells));
+
+    for (int page = 0; page < keyboard_page_count; page++) {
+        KeypadKey page_key = {0, 3, "more", NEXT_PAGE};
+        if (page + 1 == keyboard_page_count) page_key.label = "back";
+
+        keypad_place(layout, page, keyboard_digit_keys,
+                     sizeof(keyboard_digit_keys) / sizeof(KeypadKey), 1, 3);
+        keypad_place(layout, page, keyboard_fixed_keys,
+                     sizeof(keyboard_fixed_keys) / sizeof(KeypadKey), 1, 4);
+        keypad_place(layout, page, &page_key, 1, 1, 4);
+        keypad_place(layout, page, keyboard_pages[page], keyboard_page_size,
+                     1, 4);
+
+        for (size_t i = 0; i < layout->counts[page]; i++) {
+            KeypadButton* button = &layout->buttons[page][i];
+            if (button->button == EXPORT_FORMAT) {
+                button->label = export_format_labels[export_format];
+            }
+        }
+    }
+}
 
-    button_normal_color = 1;
-    button_pressed_color = 3;
+// Returns the key of page under point, or NULL.
+static const KeypadButton* keypad_hit(const KeypadLayout* layout, int page,
+                                      Vector2 point) {
+    Rectangle grid = layout->grid;
+    if (!CheckCollisionPointRec(point, grid)) return NULL;
 
-    {
-        int digit = 0;
-        {
-            if (im_button(margin_rect(split_rect_grid(container, gw, gh, 5, 0),
-                                      button_margin),
-                          "0")) {
-                pressed_button = DIGIT0;
-            }
+    int col = (point.x - grid.x) * keypad_columns / grid.width;
+    int row = (point.y - grid.y) * keypad_rows / grid.height;
+    if (col >= keypad_columns) col = keypad_columns - 1;
+    if (row >= keypad_rows) row = keypad_rows - 1;
+
+    int index = layout->cells[page][row][col];
+    if (index < 0) return NULL;
+
+    // the margins around the key are not part of it
+    const KeypadButton* button = &layout->buttons[page][index];
+    return CheckCollisionPointRec(point, button->rect) ? button : NULL;
+}
+
+// Every page of the keypad as drawn last, in a texture the size of the
+// keypad. A frame only blits it and draws the button being held over it.
+// The textures are drawn again when the keypad changes size or the label of
+// the export format key changes.
+typedef struct {
+    RenderTexture2D textures[keyboard_page_count];
+    bool drawn[keyboard_page_count];
+    float width;
+    float height;
+    ExportFormat export_format;
+} KeypadCache;
+
+static void keypad_cache_unload(KeypadCache* cache) {
+    for (int i = 0; i < keyboard_page_count; i++) {
+        if (cache->drawn[i]) UnloadRenderTexture(cache->textures[i]);
+        cache->drawn[i] = false;
+    }
+}
+
+static void keypad_render(KeypadCache* cache, const KeypadLayout* layout,
+                          int page) {
+    Rectangle container = layout->container;
+    cache->textures[page] = LoadRenderTexture(container.width,
+                                              container.height);
+    cache->drawn[page] = true;
+
+    // what the frame has drawn so far must not end up in the texture
+    im_flush();
+    BeginTextureMode(cache->textures[page]);
+    ClearBackground(color_palette[0]);
+    for (size_t i = 0; i < layout->counts[page]; i++) {
+        const KeypadButton* button = &layout->buttons[page][i];
+        Rectangle rect = button->rect;
+        rect.x -= container.x;
+        rect.y -= container.y;
+        im_draw_button(rect, button->label,
+                       color_palette[button->normal_color],
+                       color_palette[button->pressed_color]);
+    }
+    im_flush();
+    EndTextureMode();
+}
+
+// Stores the keys clicked this frame in pressed, in the order they were
+// released, and returns how many there are.
+size_t draw_keyboard(const KeypadLayout* layout, int page, KeypadCache* cache,
+                     KeyboardButton pressed[im_max_events]) {
+    Rectangle container = layout->container;
+    if (cache->width != container.width ||
+        cache->height != container.height ||
+        cache->export_format != layout->export_format) {
+        keypad_cache_unload(cache);
+        cache->width = container.width;
+        cache->height = container.height;
+        cache->export_format = layout->export_format;
+    }
+    if (!cache->drawn[page]) keypad_render(cache, layout, page);
+
+    // render textures are upside down
+    Texture2D texture = cache->textures[page].texture;
+    im_texture(texture, (Rectangle){0, 0, texture.width, -texture.height},
+               container);
+
+    const KeypadButton* buttons = layout->buttons[page];
+    size_t count = layout->counts[page];
+
+    // only keys an event landed on, or a pointer is holding, need a look
+    bool candidates[keypad_max_buttons] = {false};
+    size_t event_count;
+    const ImEvent* events = im_events(&event_count);
+    for (size_t i = 0; i < event_count; i++) {
+        const KeypadButton* hit = keypad_hit(layout, page, events[i].position);
+        if (hit) candidates[hit - buttons] = true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (im_active(im_id("keypad", buttons[i].button))) {
+            candidates[i] = true;
         }
-        digit++;
+    }
 
-        for (int row = 4; row >= 2; row--) {
-            for (int col = 0; col <= 2; col++) {
-                const char* label = TextFormat("%d", digit);
-                if (im_button(margin_rect(
-                                  split_rect_grid(container, gw, gh, row, col),
-                                  button_margin),
-                              label)) {
-                    pressed_button = DIGIT0 + digit;
-                }
-                digit++;
+    for (size_t i = 0; i < count; i++) {
+        if (!candidates[i]) continue;
+        const KeypadButton* button = &buttons[i];
+        ImButtonState state =
+            im_button_state(im_id("keypad", button->button), button->rect);
+        if (state.held) {
+            im_draw_button(button->rect, button->label,
+                           color_palette[button->pressed_color],
+                           color_palette[button->normal_color]);
+        }
+    }
+
+    size_t pressed_count = 0;
+    for (size_t i = 0; i < event_count; i++) {
+        if (!events[i].clicked) continue;
+        for (size_t j = 0; j < count; j++) {
+            if (im_id("keypad", buttons[j].button) == events[i].clicked) {
+                pressed[pressed_count++] = buttons[j].button;
+                break;
             }
         }
     }
+    return pressed_count;
+}
 
-    button_normal_color = 1;
-    button_pressed_color = 4;
+// physical keyboard
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 5, 1),
-                              button_margin),
-                  ".")) {
-        pressed_button = PERIOD;
+// Numbers and operators typed on a physical keyboard come in as characters,
+// which already have the layout and shift applied. Only the keys typing no
+// character, and the numpad so it repeats like the other keys here, go by
+// key code. character is what a numpad key types as well while num lock is
+// on, which is then skipped.
+typedef struct {
+    int key;
+    int character;
+    KeyboardButton button;
+} KeyBinding;
+
+static const KeyBinding key_bindings[] = {
+    {KEY_KP_0, '0', DIGIT0},         {KEY_KP_1, '1', DIGIT1},
+    {KEY_KP_2, '2', DIGIT2},         {KEY_KP_3, '3', DIGIT3},
+    {KEY_KP_4, '4', DIGIT4},         {KEY_KP_5, '5', DIGIT5},
+    {KEY_KP_6, '6', DIGIT6},         {KEY_KP_7, '7', DIGIT7},
+    {KEY_KP_8, '8', DIGIT8},         {KEY_KP_9, '9', DIGIT9},
+    {KEY_KP_DECIMAL, '.', PERIOD},   {KEY_KP_ADD, '+', ADD},
+    {KEY_KP_SUBTRACT, '-', SUB},     {KEY_KP_MULTIPLY, '*', MUL},
+    {KEY_KP_DIVIDE, '/', DIV},       {KEY_KP_ENTER, 0, PUSH},
+    {KEY_ENTER, 0, PUSH},            {KEY_BACKSPACE, 0, BACKSPACE},
+};
+
+#define key_binding_count (sizeof(key_bindings) / sizeof(KeyBinding))
+
+KeyboardButton key_binding(int key) {
+    for (size_t i = 0; i < key_binding_count; i++) {
+        if (key_bindings[i].key == key) return key_bindings[i].button;
     }
+    return NONE;
+}
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 5, 2),
-                              button_margin),
-                  "del")) {
-        pressed_button = BACKSPACE;
+KeyboardButton char_binding(int c) {
+    if (c >= '0' && c <= '9') return DIGIT0 + (c - '0');
+    switch (c) {
+        case '.':
+        case ',':
+            return PERIOD;
+        case '+':
+            return ADD;
+        case '-':
+            return SUB;
+        case '*':
+            return MUL;
+        case '/':
+            return DIV;
     }
+    return NONE;
+}
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 5, 3),
-                              button_margin),
-                  "push")) {
-        pressed_button = PUSH;
+// Whether c comes from a numpad key, either pressed this frame, counted in
+// numpad_chars, or held down and repeating.
+bool char_from_numpad(int c, int* numpad_chars) {
+    for (size_t i = 0; i < key_binding_count; i++) {
+        const KeyBinding* binding = &key_bindings[i];
+        if (binding->character != c) continue;
+        if (numpad_chars[i]) {
+            numpad_chars[i]--;
+            return true;
+        }
+        if (IsKeyDown(binding->key)) return true;
     }
+    return false;
+}
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 4, 3),
-                              button_margin),
-                  "+")) {
-        pressed_button = ADD;
-    }
+// raylib only queues the first press of a key, so the key pressed last
+// repeats here while it is held.
+#define key_repeat_delay 0.4
+#define key_repeat_interval (1.0 / 25)
+// presses taken from the keyboard in a frame, repeats included
+#define key_max_presses 32
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 3, 3),
-                              button_margin),
-                  "-")) {
-        pressed_button = SUB;
+typedef struct {
+    int key;
+    KeyboardButton button;
+    double next;
+} KeyRepeat;
+
+// Adds the repeats of the held key due by now to pressed, and returns the
+// new count. Repeats a stalled frame could not take are dropped.
+size_t key_repeat_update(KeyRepeat* repeat, double now,
+                         KeyboardButton* pressed, size_t count) {
+    if (!repeat->key) return count;
+    if (!IsKeyDown(repeat->key)) {
+        repeat->key = 0;
+        return count;
+    }
+    while (repeat->next <= now && count < key_max_presses) {
+        pressed[count++] = repeat->button;
+        repeat->next += key_repeat_interval;
     }
+    if (repeat->next <= now) repeat->next = now + key_repeat_interval;
+    return count;
+}
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 2, 3),
-                              button_margin),
-                  "*")) {
-        pressed_button = MUL;
+// registers
+
+// Takes the place of the keyboard while a register name is typed in, with
+// letter and digit keys and the store and recall operations.
+typedef struct {
+    bool open;
+    char name[register_name_max + 1];
+    size_t length;
+} RegisterPrompt;
+
+typedef enum {
+    REGISTER_NONE,
+    REGISTER_STORE,
+    REGISTER_RECALL,
+} RegisterAction;
+
+static void register_prompt_append(RegisterPrompt* prompt, char c) {
+    if (prompt->length == register_name_max) return;
+    prompt->name[prompt->length++] = c;
+    prompt->name[prompt->length] = '\0';
+}
+
+RegisterAction draw_register_prompt(Rectangle container,
+                                    RegisterPrompt* prompt,
+                                    const Registers* registers) {
+    int gw = 6;
+    int gh = 8;
+
+    im_rect(container, color_palette[0]);
+
+    const int button_margin = 2;
+
+    container = margin_rect(container, button_margin);
+
+    RegisterAction action = REGISTER_NONE;
+
+    // names can be typed on a physical keyboard as well
+    int c;
+    while ((c = GetCharPressed())) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_') {
+            register_prompt_append(prompt, c);
+        } else if (c >= 'A' && c <= 'Z') {
+            register_prompt_append(prompt, c - 'A' + 'a');
+        }
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 1, 3),
-                              button_margin),
-                  "/")) {
-        pressed_button = DIV;
+    {
+        Rectangle rect = split_rect_grid(container, gw, gh, 0, 0);
+        rect.width *= gw - 2;
+        rect = margin_rect(rect, button_margin);
+        im_rect(rect, color_palette[1]);
+
+        const char* text = prompt->name;
+        Number n;
+        if (registers_get(registers, prompt->name, &n)) {
+            char num[number_format_max];
+            number_format(n, num);
+            text = TextFormat("%s = %s", prompt->name, num);
+        }
+        draw_text(text, rect.x + 8, rect.y + (rect.height - gui_font_size) / 2,
+                  gui_font_size, color_palette[3]);
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 0, 3),
-                              button_margin),
-                  "pow")) {
-        pressed_button = POW;
+    button_normal_color = 1;
+    button_pressed_color = 3;
+
+    // every character register_name_valid accepts, flowing from row 1
+    const char* characters = "abcdefghijklmnopqrstuvwxyz0123456789_";
+    for (int i = 0; characters[i]; i++) {
+        char label[2] = {characters[i], '\0'};
+        if (im_button(im_id("register letter", i),
+                      margin_rect(split_rect_grid(container, gw, gh,
+                                                  1 + i / gw, i % gw),
+                                  button_margin),
+                      label)) {
+            register_prompt_append(prompt, label[0]);
+        }
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 0, 2),
+    button_normal_color = 1;
+    button_pressed_color = 4;
+
+    if (im_button(im_id("register store", 0),
+                  margin_rect(split_rect_grid(container, gw, gh, 0, gw - 2),
                               button_margin),
-                  "sqrt")) {
-        pressed_button = SQRT;
+                  "sto")) {
+        action = REGISTER_STORE;
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 1, 2),
+    if (im_button(im_id("register recall", 0),
+                  margin_rect(split_rect_grid(container, gw, gh, 0, gw - 1),
                               button_margin),
-                  "+/-")) {
-        pressed_button = TOGGLE_SIGN;
+                  "rcl")) {
+        action = REGISTER_RECALL;
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 1, 1),
-                              button_margin),
-                  "pop")) {
-        pressed_button = POP_TO_BUFFER;
+    if (im_button(
+            im_id("register delete", 0),
+            margin_rect(split_rect_grid(container, gw, gh, gh - 1, gw - 2),
+                        button_margin),
+            "del") &&
+        prompt->length) {
+        prompt->name[--prompt->length] = '\0';
     }
 
-    if (im_button(margin_rect(split_rect_grid(container, gw, gh, 1, 0),
-                              button_margin),
-                  "swap")) {
-        pressed_button = SWAP;
+    if (im_button(
+            im_id("register back", 0),
+            margin_rect(split_rect_grid(container, gw, gh, gh - 1, gw - 1),
+                        button_margin),
+            "back")) {
+        prompt->open = false;
     }
 
-    return pressed_button;
+    return action;
 }
 
 // stack
 
-typedef struct {
-    Number* items;
-    size_t count;
-    size_t capacity;
-} Stack;
+#define stack_row_cache_size 128
 
-void stack_push(Stack* stack, Number n) {
-    if (stack->capacity == 0) {
-        stack->items = malloc(4 * sizeof(Number));
-        stack->capacity = 4;
-    } else if (stack->capacity == stack->count) {
-        stack->items =
-            realloc(stack->items, stack->capacity * 2 * sizeof(Number));
-        stack->capacity = stack->capacity * 2;
+// Text of a drawn item, still good while the item at index holds value.
+typedef struct {
+    size_t index;
+    Number value;
+    bool valid;
+    int width;
+    char text[number_format_max];
+} StackRow;
+
+// How far the stack is scrolled up from the newest item, in pixels, and the
+// rows drawn recently, stored by their index modulo the cache size so the
+// visible ones never collide.
+typedef struct {
+    float scroll;
+    StackRow rows[stack_row_cache_size];
+} StackView;
+
+static const StackRow* stack_view_row(StackView* view, Stack* stack,
+                                      size_t index) {
+    StackRow* row = &view->rows[index % stack_row_cache_size];
+    Number n = stack->items[index];
+    if (!row->valid || row->index != index || row->value != n) {
+        row->index = index;
+        row->value = n;
+        row->valid = true;
+        number_format(n, row->text);
+        row->width = measure_text(row->text, gui_font_size);
     }
-    stack->items[stack->count++] = n;
+    return row;
 }
 
-Number stack_pop(Stack* stack) { return stack->items[--stack->count]; }
-
-void draw_stack(Rectangle container, Stack* stack) {
+void draw_stack(Rectangle container, Stack* stack, StackView* view) {
+    Rectangle clip = container;
     container = margin_rect(container, 8);
 
     const int spacing = 2;
+    const float row_height = gui_font_size + spacing;
 
-    for (size_t i = 0; i < stack->count; i++) {
-        char* num;
-        switch (stack->items[i]) {
-            case LLONG_MAX:
-                num = "infty";
-                break;
-            case LLONG_MIN:
-                num = "-infty";
-                break;
-            default: {
-                num = (char*)TextFormat(
-                    "%ld.%0*ld", stack->items[i] / number_scaling_factor,
-                    number_decimal_digits,
-                    llabs(stack->items[i]) % number_scaling_factor);
-                size_t it = TextLength(num);
-                size_t dropped = 0;
-                while (--it) {
-                    if (num[it] != '0' && num[it] != '.') break;
-                    num[it] = '\0';
-                    if (++dropped == number_decimal_digits + 1) break;
-                }
-            }
+    Vector2 mouse = GetMousePosition();
+    if (CheckCollisionPointRec(mouse, clip)) {
+        view->scroll += GetMouseWheelMove() * row_height * 3;
+        // a touch starting here jumps from wherever the last one ended
+        if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) &&
+            !IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            view->scroll += GetMouseDelta().y;
         }
+    }
+
+    float max_scroll = stack->count * row_height - container.height;
+    if (view->scroll > max_scroll) view->scroll = max_scroll;
+    if (view->scroll < 0) view->scroll = 0;
 
-        int w = MeasureText(num, gui_font_size);
-        DrawText(num, container.x + container.width - w,
-                 container.y + container.height -
-                     (gui_font_size + spacing) * (stack->count - i),
-                 gui_font_size, color_palette[3]);
+    // only rows from first to last, counted from the newest item, are visible
+    size_t first = view->scroll / row_height + 1;
+    size_t last = (container.height + view->scroll) / row_height + 1;
+    if (last > stack->count) last = stack->count;
+
+    im_scissor_begin(clip);
+
+    for (size_t k = first; k <= last; k++) {
+        const StackRow* row = stack_view_row(view, stack, stack->count - k);
+        draw_text(row->text, container.x + container.width - row->width,
+                  container.y + container.height - row_height * k +
+                      view->scroll,
+                  gui_font_size, color_palette[3]);
+    }
+
+    if (max_scroll > 0) {
+        float total = stack->count * row_height;
+        float h = clip.height * container.height / total;
+        float y = clip.y + (clip.height - h) * (1 - view->scroll / max_scroll);
+        im_rect((Rectangle){clip.x + clip.width - 4, y, 4, h},
+                color_palette[2]);
     }
+
+    im_scissor_end();
 }
 
-void stack_pop_onto_text_buffer(Stack* st, TextBuffer* tb) {
-    Number n = stack_pop(st);
-    switch (n) {
-        case LLONG_MAX:
-        case LLONG_MIN:
-            return;
-        default: {
-            memset(tb, 0, sizeof(TextBuffer));
-            char* num = (char*)TextFormat(
-                "%ld.%0*ld", n / number_scaling_factor, number_decimal_digits,
-                llabs(n) % number_scaling_factor);
-            size_t it = TextLength(num);
-            size_t dropped = 0;
-            while (--it) {
-                if (num[it] != '0' && num[it] != '.') break;
-                num[it] = '\0';
-                if (++dropped == number_decimal_digits + 1) break;
-            }
-            if (*num == '-') {
-                tb->negative = true;
-                num++;
-            }
-            size_t len = TextLength(num);
-            TextCopy(tb->buffer, num);
-            tb->count = tb->cursor = len;
-            for (size_t i = 0; i < len; i++) {
-                if (num[i] == '.') {
-                    tb->period_present = true;
-                    tb->period_position = i;
-                    break;
-                }
-            }
+// histogram
+
+#define histogram_default_bins 20
+#define histogram_max_bins 1000
+
+// Shown instead of the stack while bin_count is not zero. The bars are laid
+// out again only when the counts or the container change.
+typedef struct {
+    Histogram histogram;
+    size_t bin_count;
+    Rectangle* bars;
+    Rectangle container;
+} HistogramView;
+
+void draw_histogram(Rectangle container, Stack* stack, HistogramView* view) {
+    Rectangle clip = container;
+    container = margin_rect(container, 8);
+
+    Histogram* histogram = &view->histogram;
+    bool recounted = histogram_update(histogram, stack, view->bin_count);
+
+    const int font_size = gui_font_size / 2;
+    Rectangle plot = container;
+    plot.height -= font_size + 4;
+
+    // nothing is drawn while the bins or bars can not be allocated
+    size_t bin_count = histogram->bin_count;
+    if (recounted || !view->bars ||
+        memcmp(&view->container, &plot, sizeof(Rectangle))) {
+        if (recounted) {
+            free(view->bars);
+            view->bars = malloc(bin_count * sizeof(Rectangle));
+        }
+        if (!view->bars) bin_count = 0;
+        view->container = plot;
+
+        float w = plot.width / bin_count;
+        float gap = w > 4 ? 1 : 0;
+        for (size_t b = 0; b < bin_count; b++) {
+            float h = histogram->largest
+                          ? plot.height * histogram->bins[b] /
+                                histogram->largest
+                          : 0;
+            view->bars[b] = (Rectangle){plot.x + w * b,
+                                        plot.y + plot.height - h, w - gap, h};
         }
     }
+
+    im_scissor_begin(clip);
+
+    for (size_t b = 0; b < bin_count; b++) {
+        im_rect(view->bars[b], color_palette[2]);
+    }
+
+    if (stack->count) {
+        char min[number_format_max], max[number_format_max];
+        number_format(histogram->min, min);
+        number_format(histogram->max, max);
+
+        float y = container.y + container.height - font_size;
+        draw_text(min, container.x, y, font_size, color_palette[4]);
+        draw_text(max,
+                  container.x + container.width - measure_text(max, font_size),
+                  y, font_size, color_palette[4]);
+        draw_text(TextFormat("%zu", histogram->largest), container.x,
+                  container.y, font_size, color_palette[4]);
+    }
+
+    im_scissor_end();
 }
 
-typedef Number(BinaryOp)(Number, Number);
+void histogram_view_free(HistogramView* view) {
+    histogram_free(&view->histogram);
+    free(view->bars);
+    view->bars = NULL;
+}
 
-void perform_binary_op(TextBuffer* tb, Stack* st, BinaryOp* op) {
+void draw_stack_stats(Rectangle container, Stack* stack) {
+    im_rect(container, color_palette[1]);
+
+    if (!stack->count) return;
+
+    const StackStats* stats = stack_stats(stack);
+
+    char mean[number_format_max], variance[number_format_max];
+    char min[number_format_max], max[number_format_max];
+    number_format(stack_mean(stack), mean);
+    number_format(stack_variance(stack), variance);
+    number_format(stats->min, min);
+    number_format(stats->max, max);
+
+    const char* text = TextFormat("n %zu  mean %s  var %s  min %s  max %s",
+                                  stack->count, mean, variance, min, max);
+
+    int font_size = gui_font_size / 2;
+    container = margin_rect(container, 4);
+    im_scissor_begin(container);
+    draw_text(text, container.x,
+              container.y + (container.height - font_size) / 2, font_size,
+              color_palette[4]);
+    im_scissor_end();
+}
+
+// Puts n into the text buffer for editing, infinities can not be edited.
+bool text_buffer_set_number(TextBuffer* tb, Number n) {
+    if (n == LLONG_MAX || n == LLONG_MIN) return false;
+
+    char num[number_format_max];
+    size_t length = number_format(n, num);
+    if (*num == '-') {
+        text_buffer_set(tb, num + 1, length - 1, true);
+    } else {
+        text_buffer_set(tb, num, length, false);
+    }
+    return true;
+}
+
+void stack_pop_onto_text_buffer(Stack* st, TextBuffer* tb) {
+    text_buffer_set_number(tb, stack_pop(st));
+}
+
+// Pushes whatever is typed into the text buffer before an operation.
+void push_text_buffer(TextBuffer* tb, Stack* st) {
     if (tb->count) {
         Number n = text_buffer_get(tb);
         text_buffer_clear(tb);
         stack_push(st, n);
     }
+}
+
+// Argument of operations like pick or pct, typed into the text buffer or
+// else taken from the stack like in Forth.
+bool take_argument(TextBuffer* tb, Stack* st, Number* n) {
+    if (tb->count) {
+        *n = text_buffer_get(tb);
+        text_buffer_clear(tb);
+    } else if (st->count) {
+        *n = stack_pop(st);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool take_count(TextBuffer* tb, Stack* st, size_t* n) {
+    Number count;
+    if (!take_argument(tb, st, &count) || count < 0) return false;
+    *n = count / number_scaling_factor;
+    return true;
+}
+
+typedef Number(BinaryOp)(Number, Number);
+
+void perform_binary_op(TextBuffer* tb, Stack* st, BinaryOp* op) {
+    push_text_buffer(tb, st);
     if (st->count >= 2) {
         Number b = stack_pop(st);
         Number a = stack_pop(st);
@@ -536,125 +1086,644 @@ void perform_binary_op(TextBuffer* tb, Stack* st, BinaryOp* op) {
     }
 }
 
-int main() {
+// Exports and copies act on the whole stack, or on as many items from the top
+// as the number typed into the text buffer says.
+size_t selection_begin(TextBuffer* tb, Stack* st) {
+    if (!tb->count) return 0;
+
+    Number n = text_buffer_get(tb) / number_scaling_factor;
+    text_buffer_clear(tb);
+    if (n <= 0 || (size_t)n >= st->count) return 0;
+    return st->count - n;
+}
+
+// workspaces
+
+#define workspace_count 4
+// inactive stacks taking more than this are paged out to their session file
+#define workspace_page_out_size (1 << 20)
+
+// A separate calculation with its own stack, text buffer, undo history and
+// session file. The frame works on whichever one is current, so switching
+// is only a matter of changing that pointer. Everything else, including the
+// formatted rows in the stack view, stays as it was. Workspaces are opened
+// when first shown.
+typedef struct {
+    Stack st;
+    TextBuffer tb;
+    History history;
+    StackView view;
+    HistogramView histogram_view;
+    Session session;
+    bool persistent;
+    bool opened;
+} Workspace;
+
+void workspace_open(Workspace* ws, int index) {
+    const char* name = index ? TextFormat("rcalc-%d.session", index + 1)
+                             : "rcalc.session";
+    ws->persistent = session_open(&ws->session, &ws->st, app_file_path(name));
+    if (ws->persistent) {
+        SessionHeader* header = session_header(&ws->session);
+        text_buffer_set(&ws->tb, header->text, header->text_length,
+                        header->text_negative);
+        if (header->detached) {
+            TraceLog(LOG_WARNING,
+                     "The session file %s could not grow last time, its "
+                     "stack may be older or mixed with later changes",
+                     name);
+            header->detached = 0;
+        }
+    } else {
+        TraceLog(LOG_WARNING, "Could not open the session file %s", name);
+    }
+    history_commit(&ws->history, &ws->st);
+    ws->opened = true;
+}
+
+void workspace_sync(Workspace* ws) {
+    if (session_sync(&ws->session)) {
+        TraceLog(LOG_WARNING,
+                 "The session file could not grow, keeping %zu numbers in "
+                 "memory only",
+                 ws->st.count);
+    }
+}
+
+Workspace* workspace_switch(Workspace* workspaces, Workspace* current,
+                            int index) {
+    Workspace* next = &workspaces[index];
+    if (next == current) return current;
+    if (!next->opened) workspace_open(next, index);
+
+    if (current->st.count * sizeof(Number) > workspace_page_out_size) {
+        stack_page_out(&current->st);
+    }
+    return next;
+}
+
+void workspace_close(Workspace* ws) {
+    if (!ws->opened) return;
+
+    TraceLog(LOG_INFO, "History: %zu versions in %zu bytes",
+             ws->history.count, ws->history.bytes);
+
+    history_free(&ws->history);
+    if (ws->persistent) {
+        session_close(&ws->session);
+    } else {
+        stack_free(&ws->st);
+    }
+    text_buffer_free(&ws->tb);
+    histogram_view_free(&ws->histogram_view);
+}
+
+// Returns the index of the tab pressed, or -1.
+int draw_workspace_tabs(Rectangle container, Workspace* workspaces,
+                        Workspace* current) {
+    im_rect(container, color_palette[0]);
+
+    int selected = -1;
+    for (int i = 0; i < workspace_count; i++) {
+        button_normal_color = &workspaces[i] == current ? 2 : 1;
+        button_pressed_color = 3;
+        if (im_button(im_id("workspace tab", i),
+                      margin_rect(split_rect_grid(container, workspace_count,
+                                                  1, 0, i),
+                                  2),
+                      TextFormat("%d", i + 1))) {
+            selected = i;
+        }
+    }
+    return selected;
+}
+
+// layout
+
+// Parts of the screen, each split off an earlier one by split_rect_vert.
+typedef enum {
+    PANE_SCREEN,
+    PANE_UPPER,
+    PANE_TABS,
+    PANE_BELOW_TABS,
+    PANE_STACK_AREA,
+    PANE_STATS,
+    PANE_STACK,
+    PANE_TEXT,
+    PANE_KEYBOARD,
+    pane_count,
+} Pane;
+
+typedef struct {
+    Pane parent;
+    float split;
+} PaneRule;
+
+static const PaneRule pane_rules[pane_count] = {
+    [PANE_UPPER] = {PANE_SCREEN, 0.45},
+    [PANE_TABS] = {PANE_UPPER, 0.08},
+    [PANE_BELOW_TABS] = {PANE_UPPER, -0.08},
+    [PANE_STACK_AREA] = {PANE_BELOW_TABS, 0.8},
+    [PANE_STATS] = {PANE_STACK_AREA, 0.1},
+    [PANE_STACK] = {PANE_STACK_AREA, -0.1},
+    [PANE_TEXT] = {PANE_BELOW_TABS, -0.8},
+    [PANE_KEYBOARD] = {PANE_SCREEN, -0.45},
+};
+
+// The panes and the keypad, worked out again only when the screen size or
+// the export format changes.
+typedef struct {
+    int width;
+    int height;
+    Rectangle panes[pane_count];
+    KeypadLayout keypad;
+} Layout;
+
+void layout_update(Layout* layout, ExportFormat export_format) {
+    int width = GetRenderWidth();
+    int height = GetRenderHeight();
+    if (width == layout->width && height == layout->height &&
+        export_format == layout->keypad.export_format) {
+        return;
+    }
+    layout->width = width;
+    layout->height = height;
+
+    layout->panes[PANE_SCREEN] = get_screen_rect();
+    for (int i = PANE_SCREEN + 1; i < pane_count; i++) {
+        layout->panes[i] = split_rect_vert(
+            layout->panes[pane_rules[i].parent], pane_rules[i].split);
+    }
+    keypad_layout(&layout->keypad, layout->panes[PANE_KEYBOARD],
+                  export_format);
+}
+
+// main loop
+
+// frames drawn after any input, enough for a press to show and settle
+#define redraw_frames_after_input 2
+// how long an idle frame sleeps where raylib can not block on events
+#define idle_poll_interval (1.0 / 60)
+
+// Checks the input polled last for anything that could change the UI,
+// without taking events out of raylib's queues.
+bool input_happened(void) {
+    Vector2 delta = GetMouseDelta();
+    if (delta.x || delta.y || GetMouseWheelMove()) return true;
+    for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_BACK;
+         button++) {
+        if (IsMouseButtonDown(button) || IsMouseButtonReleased(button)) {
+            return true;
+        }
+    }
+    if (GetTouchPointCount()) return true;
+    for (int key = 1; key <= KEY_KB_MENU; key++) {
+        if (IsKeyPressed(key) || IsKeyReleased(key)) return true;
+    }
+    return IsWindowResized() || IsFileDropped();
+}
+
+void import_file(Stack* st, const char* path) {
+    if (!stack_import_file(st, path)) {
+        TraceLog(LOG_WARNING, "Could not import %s", path);
+    }
+}
+
+int main(int argc, char** argv) {
     TraceLog(LOG_INFO, "Hallo");
 
     InitWindow(500, 1000, "rcalc");
+    font_load();
+
+    stack_spill_directory = temp_directory();
+    const char* budget = getenv("RCALC_MEMORY_BUDGET");
+    if (budget) stack_memory_budget = strtoull(budget, NULL, 10) << 20;
+
+    // workspaces must not move, their stacks may point into themselves
+    Workspace* workspaces = calloc(workspace_count, sizeof(Workspace));
+    Workspace* ws = &workspaces[0];
+    workspace_open(ws, 0);
+
+    Registers registers = {0};
+    RegisterPrompt register_prompt = {0};
+    int keyboard_page = 0;
+    KeypadCache keypad_cache = {0};
+    Layout layout = {0};
+    ExportFormat export_format = EXPORT_LINES;
+    KeyRepeat key_repeat = {0};
+
+    // app_file_path returns a buffer raylib reuses
+    char registers_path[4096];
+    snprintf(registers_path, sizeof(registers_path), "%s",
+             app_file_path("rcalc.registers"));
+    registers_load(&registers, registers_path);
+
+    for (int i = 1; i < argc; i++) {
+        import_file(&ws->st, argv[i]);
+    }
+    history_commit(&ws->history, &ws->st);
+    workspace_sync(ws);
 
-    TextBuffer tb = {0};
-    Stack st = {0};
+    // The UI is only drawn when something may have changed it: input, the
+    // cursor blinking, or a window event. Otherwise the loop blocks on
+    // events, or sleeps where raylib can not, until the next blink.
+    int redraw_frames = redraw_frames_after_input;
+    bool focused = IsWindowFocused();
+    double start_time = GetTime();
+    double idle_time = 0;
 
     while (!WindowShouldClose()) {
+        Stack* st = &ws->st;
+        TextBuffer* tb = &ws->tb;
+        History* history = &ws->history;
+        StackView* view = &ws->view;
+        HistogramView* histogram_view = &ws->histogram_view;
+        Session* session = &ws->session;
+
+        if (!redraw_frames) {
+            double idle_start = GetTime();
+            double deadline = text_buffer_next_blink(tb, idle_start);
+            if (key_repeat.key && key_repeat.next < deadline) {
+                deadline = key_repeat.next;
+            }
+
+            if (isinf(deadline)) EnableEventWaiting();
+            PollInputEvents();
+            DisableEventWaiting();
+
+            double now = GetTime();
+            if (input_happened() || IsWindowFocused() != focused) {
+                redraw_frames = redraw_frames_after_input;
+            } else if (now >= deadline) {
+                redraw_frames = 1;
+            } else {
+                double wait = deadline - now;
+                if (wait > idle_poll_interval) wait = idle_poll_interval;
+                WaitTime(wait);
+                idle_time += GetTime() - idle_start;
+                continue;
+            }
+            idle_time += now - idle_start;
+            focused = IsWindowFocused();
+        }
+
         BeginDrawing();
+        font_begin();
+        im_begin_frame();
         ClearBackground(color_palette[0]);
 
+        // the keys typed since the last frame in order, then the keypad
+        KeyboardButton pressed[key_max_presses + im_max_events];
+        size_t pressed_count = 0;
+        double now = GetTime();
+
         int key;
         bool shoud_exit = false;
+        int numpad_chars[key_binding_count] = {0};
         while ((key = GetKeyPressed())) {
             if (key == KEY_BACK) {
                 shoud_exit = true;
                 break;
             }
+            // the register prompt reads the typed characters instead
+            if (register_prompt.open) continue;
+            KeyboardButton button = key_binding(key);
+            if (button == NONE || pressed_count == key_max_presses) continue;
+            pressed[pressed_count++] = button;
+            key_repeat = (KeyRepeat){key, button, now + key_repeat_delay};
+            for (size_t i = 0; i < key_binding_count; i++) {
+                if (key_bindings[i].key == key) numpad_chars[i]++;
+            }
+        }
+        // Characters repeat on their own while their key is held. raylib
+        // queues them apart from the keys, so within a frame they come after.
+        int c;
+        while (!register_prompt.open && (c = GetCharPressed())) {
+            KeyboardButton button = char_binding(c);
+            if (button == NONE || pressed_count == key_max_presses) continue;
+            if (char_from_numpad(c, numpad_chars)) continue;
+            pressed[pressed_count++] = button;
         }
         if (shoud_exit) break;
+        if (register_prompt.open) key_repeat.key = 0;
+        pressed_count =
+            key_repeat_update(&key_repeat, now, pressed, pressed_count);
 
-        Rectangle screen_rect = get_screen_rect();
+        bool changed = false;
 
-        {
-            Rectangle upper_pane = split_rect_vert(screen_rect, 0.45);
-            draw_stack(split_rect_vert(upper_pane, 0.8), &st);
-            draw_text_buffer(split_rect_vert(upper_pane, -0.8), &tb);
+        if (IsFileDropped()) {
+            changed = true;
+            FilePathList files = LoadDroppedFiles();
+            for (unsigned int i = 0; i < files.count; i++) {
+                import_file(st, files.paths[i]);
+            }
+            UnloadDroppedFiles(files);
         }
 
-        KeyboardButton pressed_button =
-            draw_keyboard(split_rect_vert(screen_rect, -0.45));
+        layout_update(&layout, export_format);
+        const Rectangle* panes = layout.panes;
 
-        switch (pressed_button) {
-            case NONE:
-                break;
-            case DIGIT0:
-            case DIGIT1:
-            case DIGIT2:
-            case DIGIT3:
-            case DIGIT4:
-            case DIGIT5:
-            case DIGIT6:
-            case DIGIT7:
-            case DIGIT8:
-            case DIGIT9:
-                text_buffer_append_digit(&tb, pressed_button - DIGIT0);
-                break;
-            case PERIOD:
-                text_buffer_append_period(&tb);
-                break;
-            case BACKSPACE:
-                text_buffer_backspace(&tb);
-                break;
-            case PUSH: {
-                if (tb.count) {
-                    Number n = text_buffer_get(&tb);
-                    text_buffer_clear(&tb);
-                    stack_push(&st, n);
-                }
-            } break;
-            case ADD:
-                perform_binary_op(&tb, &st, number_add);
-                break;
-            case SUB:
-                perform_binary_op(&tb, &st, number_sub);
-                break;
-            case MUL:
-                perform_binary_op(&tb, &st, number_mul);
-                break;
-            case DIV:
-                perform_binary_op(&tb, &st, number_div);
-                break;
-            case POW:
-                perform_binary_op(&tb, &st, number_pow);
-                break;
-            case SQRT: {
-                if (tb.count) {
-                    Number n = text_buffer_get(&tb);
-                    text_buffer_clear(&tb);
-                    stack_push(&st, n);
-                }
-                if (st.count) {
-                    Number a = stack_pop(&st);
-                    stack_push(&st, number_root(a, 2));
-                }
-            } break;
-            case TOGGLE_SIGN:
-                text_toggle_negative(&tb);
-                break;
-            case POP_TO_BUFFER:
-                if (st.count)
-                    stack_pop_onto_text_buffer(&st, &tb);
-                else
-                    text_buffer_clear(&tb);
-                break;
-            case SWAP:
-                if ((tb.count && st.count) || st.count > 2) {
-                    bool with_buffer = false;
-                    if (tb.count) {
-                        Number n = text_buffer_get(&tb);
-                        text_buffer_clear(&tb);
-                        stack_push(&st, n);
-                        with_buffer = true;
+        // switched to once this frame is done with the current one
+        int selected_workspace =
+            draw_workspace_tabs(panes[PANE_TABS], workspaces, ws);
+
+        draw_stack_stats(panes[PANE_STATS], st);
+        if (histogram_view->bin_count) {
+            draw_histogram(panes[PANE_STACK], st, histogram_view);
+        } else {
+            draw_stack(panes[PANE_STACK], st, view);
+        }
+        draw_text_buffer(panes[PANE_TEXT], tb);
+
+        if (register_prompt.open) {
+            RegisterAction action = draw_register_prompt(
+                panes[PANE_KEYBOARD], &register_prompt, &registers);
+            bool named = register_name_valid(register_prompt.name);
+            Number n;
+
+            switch (action) {
+                case REGISTER_NONE:
+                    break;
+                case REGISTER_STORE:
+                    // stores the top like STO on a HP, without popping it
+                    push_text_buffer(tb, st);
+                    if (named && st->count) {
+                        registers_set(&registers, register_prompt.name,
+                                      st->items[st->count - 1]);
+                        if (!registers_save(&registers, registers_path)) {
+                            TraceLog(LOG_WARNING,
+                                     "Could not save the registers");
+                        }
+                        register_prompt.open = false;
                     }
-                    Number a = stack_pop(&st);
-                    Number b = stack_pop(&st);
-                    stack_push(&st, a);
-                    stack_push(&st, b);
+                    changed = true;
+                    break;
+                case REGISTER_RECALL:
+                    if (named && registers_get(&registers,
+                                               register_prompt.name, &n)) {
+                        push_text_buffer(tb, st);
+                        stack_push(st, n);
+                        register_prompt.open = false;
+                        changed = true;
+                    }
+                    break;
+            }
+        } else {
+            pressed_count += draw_keyboard(&layout.keypad, keyboard_page,
+                                           &keypad_cache,
+                                           pressed + pressed_count);
+        }
 
-                    if (with_buffer) stack_pop_onto_text_buffer(&st, &tb);
-                }
-                break;
+        for (size_t k = 0; k < pressed_count; k++) {
+            KeyboardButton pressed_button = pressed[k];
+            switch (pressed_button) {
+                case NONE:
+                    break;
+                case DIGIT0:
+                case DIGIT1:
+                case DIGIT2:
+                case DIGIT3:
+                case DIGIT4:
+                case DIGIT5:
+                case DIGIT6:
+                case DIGIT7:
+                case DIGIT8:
+                case DIGIT9:
+                    text_buffer_append_digit(tb, pressed_button - DIGIT0);
+                    break;
+                case PERIOD:
+                    text_buffer_append_period(tb);
+                    break;
+                case BACKSPACE:
+                    text_buffer_backspace(tb);
+                    break;
+                case PUSH:
+                    push_text_buffer(tb, st);
+                    break;
+                case ADD:
+                    perform_binary_op(tb, st, number_add);
+                    break;
+                case SUB:
+                    perform_binary_op(tb, st, number_sub);
+                    break;
+                case MUL:
+                    perform_binary_op(tb, st, number_mul);
+                    break;
+                case DIV:
+                    perform_binary_op(tb, st, number_div);
+                    break;
+                case POW:
+                    perform_binary_op(tb, st, number_pow);
+                    break;
+                case SQRT: {
+                    push_text_buffer(tb, st);
+                    if (st->count) {
+                        Number a = stack_pop(st);
+                        stack_push(st, number_root(a, 2));
+                    }
+                } break;
+                case TOGGLE_SIGN:
+                    text_toggle_negative(tb);
+                    break;
+                case POP_TO_BUFFER:
+                    if (st->count)
+                        stack_pop_onto_text_buffer(st, tb);
+                    else
+                        text_buffer_clear(tb);
+                    break;
+                case SWAP:
+                    if (tb->count && st->count) {
+                        // the number being typed trades places with the top
+                        Number n = text_buffer_get(tb);
+                        if (text_buffer_set_number(tb,
+                                                   st->items[st->count - 1])) {
+                            stack_set(st, st->count - 1, n);
+                        }
+                    } else if (!tb->count) {
+                        stack_swap(st);
+                    }
+                    break;
+                case NEXT_PAGE:
+                    keyboard_page = (keyboard_page + 1) % keyboard_page_count;
+                    break;
+                case DUP:
+                    push_text_buffer(tb, st);
+                    stack_dup(st);
+                    break;
+                case DROP:
+                    if (tb->count) {
+                        text_buffer_clear(tb);
+                    } else {
+                        stack_drop(st);
+                    }
+                    break;
+                case OVER:
+                    push_text_buffer(tb, st);
+                    stack_over(st);
+                    break;
+                case ROT:
+                    push_text_buffer(tb, st);
+                    stack_rot(st);
+                    break;
+                case PICK: {
+                    size_t n;
+                    if (take_count(tb, st, &n)) stack_pick(st, n);
+                } break;
+                case ROLL: {
+                    size_t n;
+                    if (take_count(tb, st, &n)) stack_roll(st, n);
+                } break;
+                case CLEAR:
+                    text_buffer_clear(tb);
+                    stack_clear(st);
+                    break;
+                case SORT:
+                    push_text_buffer(tb, st);
+                    if (!stack_sort(st)) {
+                        TraceLog(LOG_WARNING, "Can not sort %zu numbers",
+                                 st->count);
+                    }
+                    break;
+                case UNIQUE:
+                    push_text_buffer(tb, st);
+                    if (!stack_unique(st)) {
+                        TraceLog(LOG_WARNING, "Can not sort %zu numbers",
+                                 st->count);
+                    }
+                    break;
+                case MEDIAN: {
+                    push_text_buffer(tb, st);
+                    Number n;
+                    if (stack_median(st, &n)) stack_push(st, n);
+                } break;
+                case PERCENTILE: {
+                    Number p, n;
+                    if (take_argument(tb, st, &p) && p > 0 &&
+                        p <= 100 * number_scaling_factor &&
+                        stack_percentile(st, p, &n)) {
+                        stack_push(st, n);
+                    }
+                } break;
+                case HISTOGRAM:
+                    // a typed number of bins shows or recounts the histogram,
+                    // otherwise the key toggles between it and the stack
+                    if (tb->count) {
+                        Number bins =
+                            text_buffer_get(tb) / number_scaling_factor;
+                        text_buffer_clear(tb);
+                        if (bins < 1) bins = 1;
+                        if (bins > histogram_max_bins) {
+                            bins = histogram_max_bins;
+                        }
+                        histogram_view->bin_count = bins;
+                    } else if (histogram_view->bin_count) {
+                        histogram_view->bin_count = 0;
+                    } else {
+                        histogram_view->bin_count = histogram_default_bins;
+                    }
+                    break;
+                case LINEAR_REGRESSION: {
+                    push_text_buffer(tb, st);
+                    Number slope, intercept, r2;
+                    if (stack_linear_regression(st, &slope, &intercept, &r2)) {
+                        stack_push(st, slope);
+                        stack_push(st, intercept);
+                        stack_push(st, r2);
+                    }
+                } break;
+                case EXPORT_FORMAT:
+                    export_format = (export_format + 1) % export_format_count;
+                    break;
+                case CORRELATION: {
+                    push_text_buffer(tb, st);
+                    Number r;
+                    if (stack_correlation(st, &r)) stack_push(st, r);
+                } break;
+                case DEPTH:
+                    push_text_buffer(tb, st);
+                    stack_push(st, number_handle_overflow(
+                                        (__int128_t)st->count *
+                                        number_scaling_factor));
+                    break;
+                case EXPORT: {
+                    size_t begin = selection_begin(tb, st);
+                    const char* path =
+                        user_file_path(export_file_names[export_format]);
+                    if (stack_export_file(st, begin, st->count, path,
+                                          export_format)) {
+                        TraceLog(LOG_INFO, "Exported %zu numbers to %s",
+                                 st->count - begin, path);
+                    } else {
+                        TraceLog(LOG_WARNING, "Could not export to %s", path);
+                    }
+                } break;
+                case COPY: {
+                    size_t begin = selection_begin(tb, st);
+                    char* text = stack_export_text(st, begin, st->count);
+                    if (text) {
+                        SetClipboardText(text);
+                        free(text);
+                    } else {
+                        TraceLog(LOG_WARNING,
+                                 "Can not copy %zu numbers, export them "
+                                 "instead",
+                                 st->count - begin);
+                    }
+                } break;
+                case UNDO:
+                    history_commit(history, st);
+                    history_undo(history, st);
+                    break;
+                case REDO:
+                    history_redo(history, st);
+                    break;
+                case REGISTERS:
+                    memset(&register_prompt, 0, sizeof(RegisterPrompt));
+                    register_prompt.open = true;
+                    break;
+            }
+        }
+
+        history_commit(history, st);
+
+        if (changed || pressed_count) {
+            const char* text = text_buffer_text(tb);
+            session_store_text(session, text, tb->count, tb->negative);
+            workspace_sync(ws);
+        }
+
+        if (selected_workspace >= 0) {
+            ws = workspace_switch(workspaces, ws, selected_workspace);
         }
 
+        im_end_frame();
+        font_end();
         EndDrawing();
+
+        redraw_frames--;
+        if (input_happened()) redraw_frames = redraw_frames_after_input;
+    }
+
+    double run_time = GetTime() - start_time;
+    if (run_time > 0) {
+        TraceLog(LOG_INFO, "Idle for %.1f%% of %.0f s",
+                 100 * idle_time / run_time, run_time);
     }
 
-    free(st.items);
+    TraceLog(LOG_INFO, "Stack storage allocations: %zu",
+             stack_allocation_count);
+    TraceLog(LOG_INFO, "Text measure cache: %zu hits, %zu misses",
+             text_cache_hits, text_cache_misses);
+    TraceLog(LOG_INFO, "Draw calls in the last frame: %zu",
+             im_frame_draw_calls);
+
+    for (int i = 0; i < workspace_count; i++) {
+        workspace_close(&workspaces[i]);
+    }
+    free(workspaces);
+    registers_free(&registers);
+    keypad_cache_unload(&keypad_cache);
+    font_unload();
 
     CloseWindow();
 }
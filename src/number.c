@@ -0,0 +1,247 @@
+#include "number.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+Number number_handle_overflow(__int128_t t) {
+    if (t > LLONG_MAX) return LLONG_MAX;
+    if (t < LLONG_MIN) return LLONG_MIN;
+    return t;
+}
+
+Number number_add(Number a, Number b) {
+    __int128_t ta = a;
+    __int128_t tb = b;
+    return ta + tb;
+}
+
+Number number_sub(Number a, Number b) {
+    __int128_t ta = a;
+    __int128_t tb = b;
+    return ta - tb;
+}
+
+Number number_mul(Number a, Number b) {
+    __int128_t ta = a;
+    __int128_t tb = b;
+    return number_handle_overflow((ta * tb) / number_scaling_factor);
+}
+
+Number number_div(Number a, Number b) {
+    if (b == 0) return a > 0 ? LLONG_MAX : LLONG_MIN;
+    __int128_t ta = a;
+    __int128_t tb = b;
+    return number_handle_overflow(ta * number_scaling_factor / tb);
+}
+
+Number number_root(Number x, int base) {
+    if (x == LLONG_MAX) return LLONG_MAX;
+    if (x == LLONG_MIN) return LLONG_MIN;
+
+    __int128_t l = 0, r = x;
+    while (l != r) {
+        Number c = ((__int128_t)l + (__int128_t)r + 1) / 2;
+        Number a = number_scaling_factor;
+        for (size_t i = 0; i < base; i++) {
+            a = number_mul(a, c);
+        }
+        if (a > x) {
+            r = c - 1;
+        } else {
+            l = c;
+        }
+    }
+
+    return l;
+}
+
+Number number_pow_i(Number x, int e) {
+    Number acc = number_scaling_factor;
+    Number p2 = x;
+
+    while (e) {
+        if (e & 1) acc = number_mul(acc, p2);
+        e >>= 1;
+        p2 = number_mul(p2, p2);
+    }
+
+    return acc;
+}
+
+Number number_pow(Number x, Number y) {
+    if (y < 0) {
+        return number_pow(number_div(number_scaling_factor, x), -y);
+    }
+
+    Number acc = number_pow_i(x, y / number_scaling_factor);
+
+    if (x > 0) {
+        uint64_t mantisa = y % number_scaling_factor;
+
+        Number digs[number_decimal_digits];
+        digs[0] = number_root(x, 10);
+        for (size_t i = 1; i < number_decimal_digits; i++) {
+            digs[i] = number_root(digs[i - 1], 10);
+        }
+
+        for (int i = number_decimal_digits - 1; i >= 0; i--) {
+            size_t d = mantisa % 10;
+            mantisa /= 10;
+            Number a = number_scaling_factor;
+            for (size_t j = 0; j < d; j++) {
+                a = number_mul(a, digs[i]);
+            }
+            acc = number_mul(acc, a);
+        }
+    }
+
+    return acc;
+}
+
+Number number_parse(const char** it, const char* end, bool negative) {
+    const char* p = *it;
+
+    __int128_t whole = 0;
+    bool overflow = false;
+    for (; p != end && *p >= '0' && *p <= '9'; p++) {
+        whole = whole * 10 + (*p - '0');
+        if (whole > LLONG_MAX) {
+            whole = LLONG_MAX;
+            overflow = true;
+        }
+    }
+
+    Number mantisa = 0;
+    if (p != end && *p == '.') {
+        p++;
+        int digits = 0;
+        for (; p != end && *p >= '0' && *p <= '9'; p++) {
+            if (digits == number_decimal_digits) continue;
+            mantisa = mantisa * 10 + (*p - '0');
+            digits++;
+        }
+        for (; digits < number_decimal_digits; digits++) {
+            mantisa *= 10;
+        }
+    }
+
+    *it = p;
+
+    __int128_t out = whole * number_scaling_factor + mantisa;
+    if (overflow || out >= LLONG_MAX) return negative ? LLONG_MIN : LLONG_MAX;
+
+    return negative ? -out : out;
+}
+
+size_t number_format(Number n, char* out) {
+    char* p = out;
+
+    if (n == LLONG_MAX || n == LLONG_MIN) {
+        if (n == LLONG_MIN) *p++ = '-';
+        memcpy(p, "infty", 6);
+        return p - out + 5;
+    }
+
+    uint64_t m = n;
+    if (n < 0) {
+        *p++ = '-';
+        m = -m;
+    }
+
+    uint64_t whole = m / number_scaling_factor;
+    uint64_t fraction = m % number_scaling_factor;
+
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = '0' + whole % 10;
+        whole /= 10;
+    } while (whole);
+    while (count) *p++ = digits[--count];
+
+    if (fraction) {
+        int width = number_decimal_digits;
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            width--;
+        }
+        *p++ = '.';
+        for (int i = width - 1; i >= 0; i--) {
+            p[i] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        p += width;
+    }
+
+    *p = '\0';
+    return p - out;
+}
+
+// 256 bit two's complement integer, least significant word first.
+typedef struct {
+    uint64_t w[4];
+} Wide;
+
+static Wide wide_negate(Wide a) {
+    Wide r;
+    unsigned __int128 carry = 1;
+    for (int i = 0; i < 4; i++) {
+        carry += (uint64_t)~a.w[i];
+        r.w[i] = carry;
+        carry >>= 64;
+    }
+    return r;
+}
+
+static Wide wide_mul(__int128_t a, __int128_t b) {
+    bool negative = (a < 0) != (b < 0);
+    unsigned __int128 ua = a < 0 ? -(unsigned __int128)a : a;
+    unsigned __int128 ub = b < 0 ? -(unsigned __int128)b : b;
+
+    uint64_t a0 = ua, a1 = ua >> 64;
+    uint64_t b0 = ub, b1 = ub >> 64;
+    unsigned __int128 p00 = (unsigned __int128)a0 * b0;
+    unsigned __int128 p01 = (unsigned __int128)a0 * b1;
+    unsigned __int128 p10 = (unsigned __int128)a1 * b0;
+    unsigned __int128 p11 = (unsigned __int128)a1 * b1;
+
+    Wide r;
+    unsigned __int128 t = p00;
+    r.w[0] = t;
+    t = (t >> 64) + (uint64_t)p01 + (uint64_t)p10;
+    r.w[1] = t;
+    t = (t >> 64) + (p01 >> 64) + (p10 >> 64) + (uint64_t)p11;
+    r.w[2] = t;
+    t = (t >> 64) + (p11 >> 64);
+    r.w[3] = t;
+
+    return negative ? wide_negate(r) : r;
+}
+
+static Wide wide_sub(Wide a, Wide b) {
+    b = wide_negate(b);
+    Wide r;
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < 4; i++) {
+        carry += (unsigned __int128)a.w[i] + b.w[i];
+        r.w[i] = carry;
+        carry >>= 64;
+    }
+    return r;
+}
+
+static long double wide_to_long_double(Wide a) {
+    bool negative = a.w[3] >> 63;
+    if (negative) a = wide_negate(a);
+
+    long double r = 0;
+    for (int i = 3; i >= 0; i--) r = ldexpl(r, 64) + a.w[i];
+    return negative ? -r : r;
+}
+
+long double number_spread(__int128_t n, __int128_t a, __int128_t b,
+                          __int128_t c) {
+    return wide_to_long_double(wide_sub(wide_mul(n, a), wide_mul(b, c)));
+}
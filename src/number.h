@@ -0,0 +1,49 @@
+#ifndef NUMBER_H_
+#define NUMBER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed point number, LLONG_MAX and LLONG_MIN stand for +/- infinity.
+typedef int64_t Number;
+
+#define number_decimal_digits 6
+static const int64_t number_scaling_factor = 1000000;
+
+Number number_handle_overflow(__int128_t t);
+
+Number number_add(Number a, Number b);
+
+Number number_sub(Number a, Number b);
+
+Number number_mul(Number a, Number b);
+
+Number number_div(Number a, Number b);
+
+Number number_root(Number x, int base);
+
+Number number_pow_i(Number x, int e);
+
+Number number_pow(Number x, Number y);
+
+// Parses digits with an optional fractional part, saturating to infinity
+// on overflow. Fraction digits past the precision are skipped. Advances *it
+// past the consumed characters.
+Number number_parse(const char** it, const char* end, bool negative);
+
+// Longest text number_format can produce, including the terminator.
+#define number_format_max 32
+
+// Writes n as decimal text without trailing fraction zeros, or "infty" and
+// "-infty" for the saturated values. Returns the length of the text.
+size_t number_format(Number n, char* out);
+
+// n * a - b * c, worked out exactly in 256 bit integers and only rounded at
+// the end. With n items, a the sum of their squares and b and c their sum,
+// this is n^2 times their variance, free of the cancellation the textbook
+// formula suffers in floating point.
+long double number_spread(__int128_t n, __int128_t a, __int128_t b,
+                          __int128_t c);
+
+#endif  // NUMBER_H_
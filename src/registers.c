@@ -0,0 +1,141 @@
+#include "registers.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define registers_initial_capacity 64
+
+bool register_name_valid(const char* name) {
+    size_t length = 0;
+    for (const char* it = name; *it; it++, length++) {
+        char c = *it;
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_')) {
+            return false;
+        }
+    }
+    return length > 0 && length <= register_name_max;
+}
+
+// FNV-1a
+static size_t register_hash(const char* name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* it = name; *it; it++) {
+        hash ^= (unsigned char)*it;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Slot holding name, or the empty slot where it would go.
+static Register* registers_find(const Registers* registers,
+                                const char* name) {
+    size_t mask = registers->capacity - 1;
+    size_t i = register_hash(name) & mask;
+    while (registers->slots[i].name[0] &&
+           strcmp(registers->slots[i].name, name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &registers->slots[i];
+}
+
+static void registers_grow(Registers* registers) {
+    size_t capacity = registers->capacity ? registers->capacity * 2
+                                          : registers_initial_capacity;
+    Registers grown = {
+        .slots = calloc(capacity, sizeof(Register)),
+        .capacity = capacity,
+        .count = registers->count,
+    };
+
+    for (size_t i = 0; i < registers->capacity; i++) {
+        Register* r = &registers->slots[i];
+        if (r->name[0]) *registers_find(&grown, r->name) = *r;
+    }
+
+    free(registers->slots);
+    *registers = grown;
+}
+
+bool registers_get(const Registers* registers, const char* name, Number* n) {
+    if (!registers->count) return false;
+    Register* r = registers_find(registers, name);
+    if (!r->name[0]) return false;
+    *n = r->value;
+    return true;
+}
+
+void registers_set(Registers* registers, const char* name, Number n) {
+    if ((registers->count + 1) * 2 > registers->capacity) {
+        registers_grow(registers);
+    }
+
+    Register* r = registers_find(registers, name);
+    if (!r->name[0]) {
+        strcpy(r->name, name);
+        registers->count++;
+    }
+    r->value = n;
+}
+
+bool registers_load(Registers* registers, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[register_name_max + number_format_max + 8];
+    while (fgets(line, sizeof(line), f)) {
+        char* value = strchr(line, ' ');
+        if (!value) continue;
+        *value++ = '\0';
+        if (!register_name_valid(line)) continue;
+
+        bool negative = *value == '-';
+        if (negative) value++;
+
+        const char* end = value + strcspn(value, "\r\n");
+        Number n;
+        if (end - value == 5 && strncmp(value, "infty", 5) == 0) {
+            n = negative ? LLONG_MIN : LLONG_MAX;
+        } else {
+            const char* it = value;
+            n = number_parse(&it, end, negative);
+            if (it == value || it != end) continue;
+        }
+
+        registers_set(registers, line, n);
+    }
+
+    fclose(f);
+    return true;
+}
+
+bool registers_save(const Registers* registers, const char* path) {
+    char temp[4096];
+    if (snprintf(temp, sizeof(temp), "%s.new", path) >= (int)sizeof(temp)) {
+        return false;
+    }
+
+    FILE* f = fopen(temp, "w");
+    if (!f) return false;
+
+    for (size_t i = 0; i < registers->capacity; i++) {
+        const Register* r = &registers->slots[i];
+        if (!r->name[0]) continue;
+        char num[number_format_max];
+        number_format(r->value, num);
+        fprintf(f, "%s %s\n", r->name, num);
+    }
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok && rename(temp, path) != 0) ok = false;
+    if (!ok) remove(temp);
+    return ok;
+}
+
+void registers_free(Registers* registers) {
+    free(registers->slots);
+    memset(registers, 0, sizeof(Registers));
+}
@@ -0,0 +1,45 @@
+#ifndef REGISTERS_H_
+#define REGISTERS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "number.h"
+
+// Longest register name, names are made of lowercase letters, digits and
+// underscores.
+#define register_name_max 15
+
+typedef struct {
+    char name[register_name_max + 1];
+    Number value;
+} Register;
+
+// Named registers in an open addressing hash table with linear probing. The
+// names are stored in the slots, so a lookup hashes the name and compares it
+// against a slot or two without chasing pointers. Empty slots have an empty
+// name. The table is kept at most half full.
+typedef struct {
+    Register* slots;
+    size_t capacity;
+    size_t count;
+} Registers;
+
+bool register_name_valid(const char* name);
+
+// Returns false if there is no register called name.
+bool registers_get(const Registers* registers, const char* name, Number* n);
+
+void registers_set(Registers* registers, const char* name, Number n);
+
+// Registers are kept in a text file, one "name value" line each. Loading
+// adds to what is already there and skips lines it can not make sense of.
+bool registers_load(Registers* registers, const char* path);
+
+// Writes a new file next to path and renames it over, so a crash never
+// leaves half of one behind.
+bool registers_save(const Registers* registers, const char* path);
+
+void registers_free(Registers* registers);
+
+#endif  // REGISTERS_H_
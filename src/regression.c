@@ -0,0 +1,93 @@
+#include "regression.h"
+
+#include <limits.h>
+#include <math.h>
+
+typedef struct {
+    __int128_t n;
+    __int128_t x;
+    __int128_t y;
+    __int128_t xx;
+    __int128_t yy;
+    __int128_t xy;
+    bool overflow;
+} PairSums;
+
+static void pair_sums_add(PairSums* sums, __int128_t x, __int128_t y) {
+    sums->x += x;
+    sums->y += y;
+    // the products themselves fit, only the sums can overflow
+    sums->overflow |= __builtin_add_overflow(sums->xx, x * x, &sums->xx);
+    sums->overflow |= __builtin_add_overflow(sums->yy, y * y, &sums->yy);
+    sums->overflow |= __builtin_add_overflow(sums->xy, x * y, &sums->xy);
+}
+
+static bool pair_sums(Stack* stack, PairSums* sums) {
+    *sums = (PairSums){.n = stack->count / 2};
+    if (stack->count & 1 || sums->n < 2) return false;
+
+    // the x of a pair straddling two chunks, carried over to the next one
+    bool carried = false;
+    Number carried_x = 0;
+
+    for (size_t begin = 0, end; begin < stack->count; begin = end) {
+        end = stack_stream_next(stack, begin);
+
+        const Number* items = stack->items;
+        size_t i = begin;
+        if (carried) {
+            pair_sums_add(sums, carried_x, items[i++]);
+            carried = false;
+        }
+        for (; i + 1 < end; i += 2) {
+            pair_sums_add(sums, items[i], items[i + 1]);
+        }
+        if (i < end) {
+            carried_x = items[i];
+            carried = true;
+        }
+
+        stack_stream_done(stack, begin, end);
+    }
+
+    return !sums->overflow;
+}
+
+static Number round_number(long double v) {
+    if (v >= LLONG_MAX) return LLONG_MAX;
+    if (v <= LLONG_MIN) return LLONG_MIN;
+    return llroundl(v);
+}
+
+bool stack_linear_regression(Stack* stack, Number* slope, Number* intercept,
+                             Number* r2) {
+    PairSums s;
+    if (!pair_sums(stack, &s)) return false;
+
+    long double sxx = number_spread(s.n, s.xx, s.x, s.x);
+    long double syy = number_spread(s.n, s.yy, s.y, s.y);
+    long double sxy = number_spread(s.n, s.xy, s.x, s.y);
+    if (sxx <= 0) return false;
+
+    // the scaling factors cancel in the slope, and one remains in the
+    // intercept, which is y x^2 - x xy over the x spread
+    long double fit = number_spread(s.y, s.xx, s.x, s.xy);
+    *slope = round_number(sxy / sxx * number_scaling_factor);
+    *intercept = round_number(fit / sxx);
+    *r2 = syy > 0 ? round_number(sxy / sxx * sxy / syy * number_scaling_factor)
+                  : number_scaling_factor;
+    return true;
+}
+
+bool stack_correlation(Stack* stack, Number* r) {
+    PairSums s;
+    if (!pair_sums(stack, &s)) return false;
+
+    long double sxx = number_spread(s.n, s.xx, s.x, s.x);
+    long double syy = number_spread(s.n, s.yy, s.y, s.y);
+    long double sxy = number_spread(s.n, s.xy, s.x, s.y);
+    if (sxx <= 0 || syy <= 0) return false;
+
+    *r = round_number(sxy / sqrtl(sxx) / sqrtl(syy) * number_scaling_factor);
+    return true;
+}
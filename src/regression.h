@@ -0,0 +1,24 @@
+#ifndef REGRESSION_H_
+#define REGRESSION_H_
+
+#include <stdbool.h>
+
+#include "number.h"
+#include "stack.h"
+
+// Statistics over x/y pairs stored interleaved on the stack, from the bottom
+// up with x first. They take a single pass summing x, y, xy, x^2 and y^2
+// exactly, and the formulas below combine those sums in 256 bit integers,
+// so the results are exact up to the final division and rounding. Each
+// returns false if the stack does not hold at least two whole pairs, if the
+// x (or y) values are all the same, or if the squares overflowed.
+
+// Least squares fit of y = slope * x + intercept, and its coefficient of
+// determination r^2.
+bool stack_linear_regression(Stack* stack, Number* slope, Number* intercept,
+                             Number* r2);
+
+// Pearson correlation coefficient of x and y.
+bool stack_correlation(Stack* stack, Number* r);
+
+#endif  // REGRESSION_H_
@@ -0,0 +1,180 @@
+#define _GNU_SOURCE
+
+#include "session.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define session_initial_capacity 512
+#define session_flush_interval 2
+
+static const char session_magic[8] = "RCALCSES";
+
+static void* session_flush(void* arg) {
+    Session* session = arg;
+
+    pthread_mutex_lock(&session->lock);
+    while (session->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += session_flush_interval;
+        pthread_cond_timedwait(&session->wake, &session->lock, &deadline);
+
+        if (!session->dirty) continue;
+        session->dirty = false;
+
+        // dirty pages of the mapping are in the page cache already, this
+        // only makes them survive the device going down
+        pthread_mutex_unlock(&session->lock);
+        fdatasync(session->fd);
+        pthread_mutex_lock(&session->lock);
+    }
+    pthread_mutex_unlock(&session->lock);
+
+    return NULL;
+}
+
+static bool session_header_valid(int fd) {
+    SessionHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header)) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) return false;
+
+    if (st.st_size < session_header_size) return false;
+    uint64_t capacity = (st.st_size - session_header_size) / sizeof(Number);
+
+    return memcmp(header.magic, session_magic, sizeof(session_magic)) == 0 &&
+           header.version == session_version &&
+           header.decimal_digits == number_decimal_digits &&
+           header.text_length <= session_text_capacity &&
+           header.count <= capacity;
+}
+
+static bool session_create(int fd) {
+    if (ftruncate(fd, 0) < 0) return false;
+    if (ftruncate(fd, session_header_size +
+                          session_initial_capacity * sizeof(Number)) < 0) {
+        return false;
+    }
+
+    SessionHeader header = {0};
+    memcpy(header.magic, session_magic, sizeof(session_magic));
+    header.version = session_version;
+    header.decimal_digits = number_decimal_digits;
+
+    return pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+}
+
+bool session_open(Session* session, Stack* stack, const char* path) {
+    memset(session, 0, sizeof(Session));
+    session->stack = stack;
+
+    session->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (session->fd < 0) return false;
+
+    if (!session_header_valid(session->fd)) {
+        struct stat st;
+        if (fstat(session->fd, &st) == 0 && st.st_size > 0) {
+            // keep whatever it was around instead of wiping it
+            char backup[4096];
+            snprintf(backup, sizeof(backup), "%s.old", path);
+            rename(path, backup);
+            close(session->fd);
+            session->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (session->fd < 0) return false;
+        }
+        if (!session_create(session->fd)) {
+            close(session->fd);
+            return false;
+        }
+    }
+
+    SessionHeader header;
+    pread(session->fd, &header, sizeof(header), 0);
+
+    if (!stack_map_file(stack, session->fd, session_header_size,
+                        header.count)) {
+        close(session->fd);
+        return false;
+    }
+
+    pthread_mutex_init(&session->lock, NULL);
+    pthread_cond_init(&session->wake, NULL);
+    session->running = true;
+    if (pthread_create(&session->flusher, NULL, session_flush, session)) {
+        session->running = false;
+    }
+
+    session->open = true;
+    return true;
+}
+
+SessionHeader* session_header(Session* session) {
+    Stack* stack = session->stack;
+    if (!session->open || !stack->file_mapping || stack->file_owned ||
+        stack->file_fd != session->fd ||
+        stack->file_header_size != session_header_size) {
+        return NULL;
+    }
+    return (SessionHeader*)stack->file_mapping;
+}
+
+// The mapping is gone, so the mark goes through the file descriptor.
+static void session_detach(Session* session) {
+    session->detached = true;
+
+    uint8_t detached = 1;
+    pwrite(session->fd, &detached, sizeof(detached),
+           offsetof(SessionHeader, detached));
+    fdatasync(session->fd);
+}
+
+bool session_sync(Session* session) {
+    SessionHeader* header = session_header(session);
+    if (!header) {
+        if (!session->open || session->detached) return false;
+        session_detach(session);
+        return true;
+    }
+
+    header->count = session->stack->count;
+
+    pthread_mutex_lock(&session->lock);
+    session->dirty = true;
+    pthread_mutex_unlock(&session->lock);
+    return false;
+}
+
+void session_store_text(Session* session, const char* text, size_t length,
+                        bool negative) {
+    SessionHeader* header = session_header(session);
+    if (!header) return;
+
+    if (length > session_text_capacity) length = session_text_capacity;
+    memcpy(header->text, text, length);
+    header->text_length = length;
+    header->text_negative = negative;
+}
+
+void session_close(Session* session) {
+    if (session->running) {
+        pthread_mutex_lock(&session->lock);
+        session->running = false;
+        pthread_cond_signal(&session->wake);
+        pthread_mutex_unlock(&session->lock);
+        pthread_join(session->flusher, NULL);
+    }
+
+    session_sync(session);
+    stack_free(session->stack);
+    fdatasync(session->fd);
+    close(session->fd);
+    pthread_mutex_destroy(&session->lock);
+    pthread_cond_destroy(&session->wake);
+    memset(session, 0, sizeof(Session));
+}
@@ -0,0 +1,70 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stack.h"
+
+// The stack is kept in a memory mapped session file, so everything on it
+// survives the app being killed and restoring it is a single mmap. The first
+// page of the file is a SessionHeader, the items follow it.
+
+#define session_header_size 4096
+#define session_version 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t decimal_digits;
+    uint64_t count;
+    // contents of the text buffer, cut to what fits in the page
+    uint32_t text_length;
+    uint8_t text_negative;
+    // the stack left the file when it could not grow, so count and the items
+    // are what they were then and may have been partly overwritten since
+    uint8_t detached;
+    char text[];
+} SessionHeader;
+
+#define session_text_capacity \
+    (session_header_size - offsetof(SessionHeader, text))
+
+typedef struct {
+    Stack* stack;
+    int fd;
+    // session_open succeeded
+    bool open;
+    // the stack has left the session file, which is marked detached
+    bool detached;
+    // written back to disk every so often by a background thread
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool dirty;
+    bool running;
+} Session;
+
+// Maps the session file at path into the stack, creating it if needed.
+// Returns false if the stack stays in memory only.
+bool session_open(Session* session, Stack* stack, const char* path);
+
+// The header in the stack's mapping, or NULL while the stack is not mapped
+// from the session file: when the session did not open, or once the file
+// could not grow and the stack went to memory or a spill file.
+SessionHeader* session_header(Session* session);
+
+// Records the stack count in the header and schedules a flush. Call after
+// anything changed. Returns true in the call that finds the stack has left
+// the session file, after marking the file detached.
+bool session_sync(Session* session);
+
+void session_store_text(Session* session, const char* text, size_t length,
+                        bool negative);
+
+// Flushes and unmaps the session, leaving the stack empty. Only call after a
+// successful session_open.
+void session_close(Session* session);
+
+#endif  // SESSION_H_
@@ -0,0 +1,199 @@
+#include "sort.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define sort_digit_bits 11
+#define sort_digit_count (1 << sort_digit_bits)
+#define sort_passes ((64 + sort_digit_bits - 1) / sort_digit_bits)
+#define sort_small_count 32
+// larger inputs start with a pass over the most significant digit
+#define sort_lsd_count (1 << 16)
+
+static void insertion_sort(Number* items, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        Number n = items[i];
+        size_t j = i;
+        for (; j > 0 && items[j - 1] > n; j--) items[j] = items[j - 1];
+        items[j] = n;
+    }
+}
+
+static size_t digit_of(uint64_t key, int pass) {
+    return (key >> (pass * sort_digit_bits)) & (sort_digit_count - 1);
+}
+
+// LSD passes over the low digits of the keys in from, using to as scratch.
+// Returns whichever of the two holds the sorted keys.
+static uint64_t* radix_passes(uint64_t* from, uint64_t* to, size_t count,
+                              int passes,
+                              size_t (*histograms)[sort_digit_count]) {
+    memset(histograms, 0, passes * sizeof(*histograms));
+    for (size_t i = 0; i < count; i++) {
+        for (int pass = 0; pass < passes; pass++) {
+            histograms[pass][digit_of(from[i], pass)]++;
+        }
+    }
+
+    for (int pass = 0; pass < passes; pass++) {
+        size_t* histogram = histograms[pass];
+        if (histogram[digit_of(from[0], pass)] == count) continue;
+
+        size_t offset = 0;
+        for (size_t d = 0; d < sort_digit_count; d++) {
+            size_t n = histogram[d];
+            histogram[d] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uint64_t key = from[i];
+            to[histogram[digit_of(key, pass)]++] = key;
+        }
+
+        uint64_t* t = from;
+        from = to;
+        to = t;
+    }
+    return from;
+}
+
+bool number_sort(Number* items, size_t count) {
+    if (count < sort_small_count) {
+        insertion_sort(items, count);
+        return true;
+    }
+
+    Number min = items[0], max = items[0];
+    for (size_t i = 1; i < count; i++) {
+        if (items[i] < min) min = items[i];
+        if (items[i] > max) max = items[i];
+    }
+
+    // keys are offsets from the minimum, which orders them like the signed
+    // values and leaves the high digits zero for anything but huge ranges
+    uint64_t range = (uint64_t)max - (uint64_t)min;
+    int passes = 0;
+    while (passes < sort_passes && range >> (passes * sort_digit_bits)) {
+        passes++;
+    }
+    if (passes == 0) return true;
+
+    uint64_t* keys = (uint64_t*)items;
+    uint64_t* scratch = malloc(count * sizeof(uint64_t));
+    size_t(*histograms)[sort_digit_count] =
+        malloc(passes * sizeof(*histograms));
+    if (!scratch || !histograms) {
+        free(scratch);
+        free(histograms);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) keys[i] -= (uint64_t)min;
+
+    if (count <= sort_lsd_count || passes == 1) {
+        uint64_t* sorted = radix_passes(keys, scratch, count, passes,
+                                        histograms);
+        if (sorted != keys) memcpy(keys, sorted, count * sizeof(uint64_t));
+    } else {
+        // Past what fits in the cache every LSD pass goes through memory,
+        // so the top digit is done first, most significant digit style, and
+        // the buckets it leaves are small enough to finish in the cache.
+        int top = passes - 1;
+        size_t* histogram = histograms[top];
+        memset(histogram, 0, sizeof(*histograms));
+        for (size_t i = 0; i < count; i++) {
+            histogram[digit_of(keys[i], top)]++;
+        }
+
+        size_t offset = 0;
+        for (size_t d = 0; d < sort_digit_count; d++) {
+            size_t n = histogram[d];
+            histogram[d] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint64_t key = keys[i];
+            scratch[histogram[digit_of(key, top)]++] = key;
+        }
+
+        // each bucket now ends where the next one starts
+        size_t begin = 0;
+        for (size_t d = 0; d < sort_digit_count; d++) {
+            size_t end = histogram[d];
+            size_t n = end - begin;
+            if (n < sort_small_count) {
+                insertion_sort((Number*)&scratch[begin], n);
+                memcpy(&keys[begin], &scratch[begin], n * sizeof(uint64_t));
+            } else if (n) {
+                uint64_t* sorted = radix_passes(&scratch[begin], &keys[begin],
+                                                n, top, histograms);
+                if (sorted != &keys[begin]) {
+                    memcpy(&keys[begin], sorted, n * sizeof(uint64_t));
+                }
+            }
+            begin = end;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) keys[i] += (uint64_t)min;
+
+    free(histograms);
+    free(scratch);
+    return true;
+}
+
+static Number median_of_three(Number a, Number b, Number c) {
+    if (a > b) {
+        Number t = a;
+        a = b;
+        b = t;
+    }
+    if (b > c) b = c;
+    return a > b ? a : b;
+}
+
+Number number_select(Number* items, size_t count, size_t k) {
+    size_t lo = 0, hi = count;
+
+    int budget = 0;
+    for (size_t n = count; n > 1; n >>= 1) budget += 2;
+
+    while (hi - lo > sort_small_count) {
+        if (budget-- == 0) {
+            number_sort(&items[lo], hi - lo);
+            return items[k];
+        }
+
+        Number pivot = median_of_three(items[lo], items[lo + (hi - lo) / 2],
+                                       items[hi - 1]);
+
+        // three way partition into [lo, lt) < pivot, [lt, gt) == pivot and
+        // [gt, hi) > pivot, so runs of equal items do not degrade it
+        size_t lt = lo, i = lo, gt = hi;
+        while (i < gt) {
+            Number n = items[i];
+            if (n < pivot) {
+                items[i++] = items[lt];
+                items[lt++] = n;
+            } else if (n > pivot) {
+                items[i] = items[--gt];
+                items[gt] = n;
+            } else {
+                i++;
+            }
+        }
+
+        if (k < lt) {
+            hi = lt;
+        } else if (k >= gt) {
+            lo = gt;
+        } else {
+            return pivot;
+        }
+    }
+
+    insertion_sort(&items[lo], hi - lo);
+    return items[k];
+}
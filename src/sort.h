@@ -0,0 +1,23 @@
+#ifndef SORT_H_
+#define SORT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "number.h"
+
+// Sorts ascending with an LSD radix sort over 11 bit digits of the offset
+// from the minimum, so only as many passes run as the range of the values
+// needs, and passes where every item has the same digit are skipped. Large
+// inputs are first split on the top digit so the rest runs in the cache.
+// Needs a scratch copy of the items, returns false leaving them as they were
+// if it can not be allocated.
+bool number_sort(Number* items, size_t count);
+
+// Reorders items so that items[k] is the one a sort would put there, with
+// nothing greater before it and nothing smaller after it, and returns it.
+// Introselect: quickselect that falls back to sorting the remaining range
+// when partitioning keeps going badly.
+Number number_select(Number* items, size_t count, size_t k);
+
+#endif  // SORT_H_
@@ -0,0 +1,634 @@
+#define _GNU_SOURCE
+
+#include "stack.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sort.h"
+
+#if UINTPTR_MAX > 0xffffffff
+#define stack_reserved_size ((size_t)1 << 36)
+#else
+#define stack_reserved_size ((size_t)1 << 28)
+#endif
+
+// chunks of file backed stacks, which are paged in and out as a whole
+#define stack_chunk_size ((size_t)4 << 20)
+
+size_t stack_allocation_count = 0;
+size_t stack_memory_budget = (size_t)256 << 20;
+const char* stack_spill_directory = NULL;
+
+// Room for at least capacity items, in a reserved range if it fits there or
+// from malloc. Sets what it got without touching the stack, whose current
+// items are released by what they are. Returns NULL if out of memory.
+static Number* stack_allocate(size_t capacity, bool* reserved,
+                              size_t* allocated) {
+    stack_allocation_count++;
+
+    if (capacity * sizeof(Number) <= stack_reserved_size) {
+        void* items = mmap(NULL, stack_reserved_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (items != MAP_FAILED) {
+            *reserved = true;
+            *allocated = stack_reserved_size / sizeof(Number);
+            return items;
+        }
+    }
+
+    *reserved = false;
+    *allocated = capacity;
+    return malloc(capacity * sizeof(Number));
+}
+
+static void stack_release(Stack* stack) {
+    free(stack->resident);
+    stack->resident = NULL;
+    stack->resident_count = 0;
+
+    if (stack->items == stack->inline_items || !stack->items) return;
+    if (stack->file_mapping) {
+        munmap(stack->file_mapping, stack->file_size);
+        stack->file_mapping = NULL;
+        if (stack->file_owned) close(stack->file_fd);
+        stack->file_owned = false;
+    } else if (stack->reserved) {
+        munmap(stack->items, stack_reserved_size);
+    } else {
+        free(stack->items);
+    }
+}
+
+static bool stack_over_budget(Stack* stack, size_t capacity) {
+    return stack_memory_budget && !stack->file_mapping &&
+           !stack->spill_failed &&
+           capacity * sizeof(Number) > stack_memory_budget;
+}
+
+// Moves the items into an unlinked file in stack_spill_directory with room
+// for capacity items.
+static bool stack_spill(Stack* stack, size_t capacity) {
+    if (!stack_spill_directory) return false;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/rcalc-spill-XXXXXX",
+             stack_spill_directory);
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    unlink(path);
+
+    size_t size = capacity * sizeof(Number);
+    char* mapping = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    stack_allocation_count++;
+
+    memcpy(mapping, stack->items, stack->count * sizeof(Number));
+    stack_release(stack);
+    stack->file_mapping = mapping;
+    stack->file_size = size;
+    stack->file_header_size = 0;
+    stack->file_fd = fd;
+    stack->file_owned = true;
+    stack->reserved = false;
+    stack->items = (Number*)mapping;
+    stack->capacity = capacity;
+
+    // everything below the top is cold already
+    stack_release_items(stack, 0, stack->count);
+    return true;
+}
+
+bool stack_reserve(Stack* stack, size_t capacity) {
+    if (!stack->items) {
+        stack->items = stack->inline_items;
+        stack->capacity = stack_inline_capacity;
+    }
+    if (stack_over_budget(stack, capacity)) {
+        size_t spill_capacity = stack->count * 2;
+        if (spill_capacity < capacity) spill_capacity = capacity;
+        if (!stack_spill(stack, spill_capacity)) stack->spill_failed = true;
+    }
+    if (stack->capacity >= capacity) return true;
+
+    if (stack->file_mapping) {
+        if (capacity < stack->capacity * 2) capacity = stack->capacity * 2;
+        size_t size = stack->file_header_size + capacity * sizeof(Number);
+        if (ftruncate(stack->file_fd, size) == 0) {
+            char* mapping = mremap(stack->file_mapping, stack->file_size, size,
+                                   MREMAP_MAYMOVE);
+            if (mapping != MAP_FAILED) {
+                stack_allocation_count++;
+                stack->file_mapping = mapping;
+                stack->file_size = size;
+                stack->items = (Number*)(mapping + stack->file_header_size);
+                stack->capacity = capacity;
+                return true;
+            }
+        }
+        // the file can not grow, carry on in memory
+    }
+
+    if (!stack->reserved && !stack->file_mapping &&
+        stack->items != stack->inline_items) {
+        stack_allocation_count++;
+        Number* items = realloc(stack->items, capacity * sizeof(Number));
+        if (!items) return false;
+        stack->items = items;
+        stack->capacity = capacity;
+        return true;
+    }
+
+    bool reserved;
+    size_t allocated;
+    Number* items = stack_allocate(capacity, &reserved, &allocated);
+    if (!items) return false;
+    memcpy(items, stack->items, stack->count * sizeof(Number));
+    stack_release(stack);
+    stack->items = items;
+    stack->reserved = reserved;
+    stack->capacity = allocated;
+    return true;
+}
+
+static void stack_stats_add(Stack* stack, Number n) {
+    StackStats* stats = &stack->stats;
+
+    if (!stats->extremes_stale) {
+        if (stack->count == 0 || n < stats->min) stats->min = n;
+        if (stack->count == 0 || n > stats->max) stats->max = n;
+    }
+
+    if (stats->sums_stale) return;
+    stats->sum += n;
+    if (!stats->overflow &&
+        __builtin_add_overflow(stats->sum_squares, (__int128_t)n * n,
+                               &stats->sum_squares)) {
+        stats->overflow = true;
+    }
+}
+
+static void stack_stats_remove(Stack* stack, Number n) {
+    StackStats* stats = &stack->stats;
+
+    if (n == stats->min || n == stats->max) stats->extremes_stale = true;
+
+    if (stats->overflow) {
+        // can not be undone, the squares need summing again
+        stats->sums_stale = true;
+    } else if (!stats->sums_stale) {
+        stats->sum -= n;
+        stats->sum_squares -= (__int128_t)n * n;
+    }
+}
+
+bool stack_push(Stack* stack, Number n) {
+    if (stack->capacity == stack->count) {
+        if (!stack_reserve(stack, stack->capacity ? stack->capacity * 2
+                                                  : stack_inline_capacity) &&
+            !stack_reserve(stack, stack->count + 1)) {
+            return false;
+        }
+    } else if (stack_over_budget(stack, stack->count + 1)) {
+        stack_reserve(stack, stack->count + 1);
+    }
+    stack_touch(stack, stack->count);
+    stack_stats_add(stack, n);
+    stack->items[stack->count++] = n;
+    return true;
+}
+
+Number stack_pop(Stack* stack) {
+    Number n = stack->items[--stack->count];
+    stack_stats_remove(stack, n);
+    stack->generation++;
+    return n;
+}
+
+void stack_set(Stack* stack, size_t index, Number n) {
+    stack_stats_remove(stack, stack->items[index]);
+    // extremes are only compared against, the count does not matter
+    stack_stats_add(stack, n);
+    stack->items[index] = n;
+    stack_touch(stack, index);
+}
+
+bool stack_dup(Stack* stack) { return stack_pick(stack, 0); }
+
+bool stack_drop(Stack* stack) {
+    if (stack->count < 1) return false;
+    stack_pop(stack);
+    return true;
+}
+
+bool stack_swap(Stack* stack) { return stack_roll(stack, 1); }
+
+bool stack_over(Stack* stack) { return stack_pick(stack, 1); }
+
+bool stack_rot(Stack* stack) { return stack_roll(stack, 2); }
+
+bool stack_pick(Stack* stack, size_t n) {
+    if (n >= stack->count) return false;
+    stack_push(stack, stack->items[stack->count - 1 - n]);
+    return true;
+}
+
+bool stack_roll(Stack* stack, size_t n) {
+    if (n >= stack->count) return false;
+    size_t index = stack->count - 1 - n;
+    Number item = stack->items[index];
+    memmove(&stack->items[index], &stack->items[index + 1],
+            n * sizeof(Number));
+    stack->items[stack->count - 1] = item;
+    stack_touch(stack, index);
+    return true;
+}
+
+void stack_clear(Stack* stack) {
+    stack->count = 0;
+    stack_touch(stack, 0);
+    memset(&stack->stats, 0, sizeof(StackStats));
+}
+
+static bool stack_fits_budget(Stack* stack) {
+    return !stack_memory_budget ||
+           stack->count <= stack_memory_budget / sizeof(Number);
+}
+
+bool stack_sort(Stack* stack) {
+    if (!stack_fits_budget(stack)) return false;
+    if (!number_sort(stack->items, stack->count)) return false;
+    stack_touch(stack, 0);
+    return true;
+}
+
+bool stack_unique(Stack* stack) {
+    if (!stack_sort(stack)) return false;
+
+    size_t count = 0;
+    for (size_t i = 0; i < stack->count; i++) {
+        if (count && stack->items[count - 1] == stack->items[i]) continue;
+        stack->items[count++] = stack->items[i];
+    }
+    stack->count = count;
+    stack_invalidate_stats(stack);
+    return true;
+}
+
+#define select_digit_bits 16
+#define select_digit_count (1 << select_digit_bits)
+
+// Finds the item of rank k one 16 bit digit at a time, from the top, by
+// counting the digits of the items that share the digits found so far. The
+// keys flip the sign bit so they order like the signed values. Every pass
+// streams the stack, so no copy of it is needed.
+static Number stack_select_streamed(Stack* stack, size_t k,
+                                    size_t* histogram) {
+    uint64_t prefix = 0;
+    uint64_t mask = 0;
+
+    for (int shift = 64 - select_digit_bits; shift >= 0;
+         shift -= select_digit_bits) {
+        memset(histogram, 0, select_digit_count * sizeof(size_t));
+
+        for (size_t begin = 0, end; begin < stack->count; begin = end) {
+            end = stack_stream_next(stack, begin);
+            for (size_t i = begin; i < end; i++) {
+                uint64_t key = (uint64_t)stack->items[i] ^ (1ull << 63);
+                if ((key & mask) != prefix) continue;
+                histogram[(key >> shift) & (select_digit_count - 1)]++;
+            }
+            stack_stream_done(stack, begin, end);
+        }
+
+        uint64_t digit = 0;
+        while (k >= histogram[digit]) k -= histogram[digit++];
+        prefix |= digit << shift;
+        mask |= (uint64_t)(select_digit_count - 1) << shift;
+    }
+
+    return prefix ^ (1ull << 63);
+}
+
+// Selects on a copy, so the stack keeps its order, and falls back to
+// streaming when the copy does not fit. next, if given, gets the item of
+// rank k + 1, or the same item if k is the last rank. Returns false if not
+// even the streaming histogram can be allocated.
+static bool stack_select(Stack* stack, size_t k, Number* n, Number* next) {
+    Number* items = NULL;
+    if (stack_fits_budget(stack)) {
+        items = malloc(stack->count * sizeof(Number));
+    }
+
+    if (!items) {
+        size_t* histogram = malloc(select_digit_count * sizeof(size_t));
+        if (!histogram) return false;
+        *n = stack_select_streamed(stack, k, histogram);
+        if (next) {
+            *next = k + 1 < stack->count
+                        ? stack_select_streamed(stack, k + 1, histogram)
+                        : *n;
+        }
+        free(histogram);
+        return true;
+    }
+
+    memcpy(items, stack->items, stack->count * sizeof(Number));
+
+    *n = number_select(items, stack->count, k);
+
+    if (next) {
+        *next = *n;
+        if (k + 1 < stack->count) {
+            *next = items[k + 1];
+            for (size_t i = k + 2; i < stack->count; i++) {
+                if (items[i] < *next) *next = items[i];
+            }
+        }
+    }
+
+    free(items);
+    return true;
+}
+
+bool stack_percentile(Stack* stack, Number p, Number* n) {
+    if (!stack->count) return false;
+
+    __int128_t scale = (__int128_t)100 * number_scaling_factor;
+    __int128_t rank = ((__int128_t)p * stack->count + scale - 1) / scale;
+    if (rank < 1) rank = 1;
+    if (rank > stack->count) rank = stack->count;
+
+    return stack_select(stack, rank - 1, n, NULL);
+}
+
+bool stack_median(Stack* stack, Number* n) {
+    if (!stack->count) return false;
+
+    if (stack->count & 1) return stack_select(stack, stack->count / 2, n, NULL);
+
+    Number lower, upper;
+    if (!stack_select(stack, stack->count / 2 - 1, &lower, &upper)) {
+        return false;
+    }
+    *n = ((__int128_t)lower + upper) / 2;
+    return true;
+}
+
+// chunks
+
+static size_t stack_chunk_of(Stack* stack, size_t index) {
+    return (stack->file_header_size + index * sizeof(Number)) /
+           stack_chunk_size;
+}
+
+static void stack_advise_chunks(Stack* stack, size_t first, size_t last,
+                                int advice) {
+    size_t begin = first * stack_chunk_size;
+    size_t end = (last + 1) * stack_chunk_size;
+    if (end > stack->file_size) end = stack->file_size;
+    if (begin < end) madvise(stack->file_mapping + begin, end - begin, advice);
+}
+
+static void stack_drop_chunks(Stack* stack, size_t first, size_t last) {
+#ifdef MADV_PAGEOUT
+    stack_advise_chunks(stack, first, last, MADV_PAGEOUT);
+#else
+    stack_advise_chunks(stack, first, last, MADV_DONTNEED);
+#endif
+}
+
+static StackChunk* stack_find_resident(Stack* stack, size_t chunk) {
+    for (size_t i = 0; i < stack->resident_count; i++) {
+        if (stack->resident[i].chunk == chunk) return &stack->resident[i];
+    }
+    return NULL;
+}
+
+// Records a use of the chunk, dropping the least recently used one when
+// more than the budget would be resident.
+static void stack_use_chunk(Stack* stack, size_t chunk) {
+    if (!stack->file_mapping || !stack_memory_budget) return;
+
+    size_t max_resident = stack_memory_budget / stack_chunk_size;
+    if (max_resident < 2) max_resident = 2;
+    if (!stack->resident) {
+        stack->resident = malloc(max_resident * sizeof(StackChunk));
+        stack->resident_count = 0;
+    }
+
+    StackChunk* c = stack_find_resident(stack, chunk);
+    if (!c) {
+        if (stack->resident_count < max_resident) {
+            c = &stack->resident[stack->resident_count++];
+        } else {
+            c = &stack->resident[0];
+            for (size_t i = 1; i < stack->resident_count; i++) {
+                if (stack->resident[i].last_used < c->last_used) {
+                    c = &stack->resident[i];
+                }
+            }
+            stack_drop_chunks(stack, c->chunk, c->chunk);
+        }
+    }
+
+    // the most recently used chunk goes last, for stack_touch to check
+    StackChunk* last = &stack->resident[stack->resident_count - 1];
+    *c = *last;
+    *last = (StackChunk){.chunk = chunk, .last_used = ++stack->use_clock};
+}
+
+size_t stack_stream_next(Stack* stack, size_t begin) {
+    if (!stack->file_mapping || !stack_memory_budget ||
+        stack->count * sizeof(Number) <= stack_memory_budget) {
+        return stack->count;
+    }
+
+    size_t chunk = stack_chunk_of(stack, begin);
+    size_t end = ((chunk + 1) * stack_chunk_size - stack->file_header_size) /
+                 sizeof(Number);
+    if (end > stack->count) end = stack->count;
+
+    if (begin == 0) stack_advise_chunks(stack, chunk, chunk, MADV_WILLNEED);
+    stack_advise_chunks(stack, chunk + 1, chunk + 1, MADV_WILLNEED);
+    return end;
+}
+
+void stack_stream_done(Stack* stack, size_t begin, size_t end) {
+    if (end - begin < stack->count) stack_release_items(stack, begin, end);
+}
+
+void stack_release_items(Stack* stack, size_t begin, size_t end) {
+    if (!stack->file_mapping || begin >= end) return;
+
+    // runs of cold chunks go in one call
+    size_t last = stack_chunk_of(stack, end - 1);
+    size_t run = SIZE_MAX;
+    for (size_t chunk = stack_chunk_of(stack, begin); chunk <= last;
+         chunk++) {
+        bool cold = !stack_find_resident(stack, chunk);
+        if (cold && run == SIZE_MAX) run = chunk;
+        if (!cold && run != SIZE_MAX) {
+            stack_drop_chunks(stack, run, chunk - 1);
+            run = SIZE_MAX;
+        }
+    }
+    if (run != SIZE_MAX) stack_drop_chunks(stack, run, last);
+}
+
+void stack_touch(Stack* stack, size_t index) {
+    if (index < stack->dirty_from) stack->dirty_from = index;
+    stack->generation++;
+
+    if (stack->file_mapping) {
+        size_t chunk = stack_chunk_of(stack, index);
+        if (!stack->resident_count ||
+            stack->resident[stack->resident_count - 1].chunk != chunk) {
+            stack_use_chunk(stack, chunk);
+        }
+    }
+}
+
+void stack_invalidate_stats(Stack* stack) {
+    stack->stats.sums_stale = true;
+    stack->stats.extremes_stale = true;
+    stack->generation++;
+}
+
+const StackStats* stack_stats(Stack* stack) {
+    StackStats* stats = &stack->stats;
+
+    bool sums = stats->sums_stale;
+    bool extremes = stats->extremes_stale && stack->count;
+    if (!sums && !extremes) return stats;
+
+    if (sums) {
+        stats->sum = 0;
+        stats->sum_squares = 0;
+        stats->overflow = false;
+    }
+    if (extremes) {
+        stats->min = stack->items[stack->count - 1];
+        stats->max = stack->items[stack->count - 1];
+    }
+
+    // one pass for both, it may have to come from disk
+    for (size_t begin = 0, end; begin < stack->count; begin = end) {
+        end = stack_stream_next(stack, begin);
+
+        if (sums) {
+            for (size_t i = begin; i < end; i++) {
+                Number n = stack->items[i];
+                stats->sum += n;
+                if (!stats->overflow &&
+                    __builtin_add_overflow(stats->sum_squares,
+                                           (__int128_t)n * n,
+                                           &stats->sum_squares)) {
+                    stats->overflow = true;
+                }
+            }
+        }
+
+        if (extremes) {
+            Number min = stats->min;
+            Number max = stats->max;
+            for (size_t i = begin; i < end; i++) {
+                Number n = stack->items[i];
+                if (n < min) min = n;
+                if (n > max) max = n;
+            }
+            stats->min = min;
+            stats->max = max;
+        }
+
+        stack_stream_done(stack, begin, end);
+    }
+
+    stats->sums_stale = false;
+    if (extremes) stats->extremes_stale = false;
+
+    return stats;
+}
+
+Number stack_mean(Stack* stack) {
+    const StackStats* stats = stack_stats(stack);
+    if (!stack->count) return 0;
+    return number_handle_overflow(stats->sum / (__int128_t)stack->count);
+}
+
+Number stack_variance(Stack* stack) {
+    const StackStats* stats = stack_stats(stack);
+    if (!stack->count) return 0;
+    if (stats->overflow) return LLONG_MAX;
+
+    long double n = stack->count;
+    long double variance = number_spread(stack->count, stats->sum_squares,
+                                         stats->sum, stats->sum) /
+                           (n * n * number_scaling_factor);
+    if (variance >= LLONG_MAX) return LLONG_MAX;
+    return llroundl(variance);
+}
+
+bool stack_map_file(Stack* stack, int fd, size_t header_size, size_t count) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) return false;
+    size_t size = st.st_size;
+    if (size < header_size + count * sizeof(Number)) return false;
+
+    char* mapping =
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) return false;
+    stack_allocation_count++;
+
+    stack_release(stack);
+    stack->file_mapping = mapping;
+    stack->file_size = size;
+    stack->file_header_size = header_size;
+    stack->file_fd = fd;
+    stack->reserved = false;
+    stack->items = (Number*)(mapping + header_size);
+    stack->capacity = (size - header_size) / sizeof(Number);
+    stack->count = count;
+    stack->dirty_from = 0;
+    stack_invalidate_stats(stack);
+    return true;
+}
+
+void stack_page_out(Stack* stack) {
+    if (!stack->file_mapping) return;
+
+    // the pages are clean by the time they go, so dropping them is cheap
+    msync(stack->file_mapping, stack->file_size, MS_ASYNC);
+#ifdef MADV_PAGEOUT
+    if (madvise(stack->file_mapping, stack->file_size, MADV_PAGEOUT) == 0) {
+        return;
+    }
+#endif
+    // a shared mapping keeps its data in the page cache, which the kernel
+    // can then reclaim as it likes
+    madvise(stack->file_mapping, stack->file_size, MADV_DONTNEED);
+}
+
+void stack_free(Stack* stack) {
+    stack_release(stack);
+    stack->items = NULL;
+    stack->count = 0;
+    stack->capacity = 0;
+    stack->reserved = false;
+    stack->spill_failed = false;
+    stack->dirty_from = 0;
+    memset(&stack->stats, 0, sizeof(StackStats));
+}
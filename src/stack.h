@@ -0,0 +1,170 @@
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "number.h"
+
+#define stack_inline_capacity 32
+
+// Running statistics of the items, updated by every push and pop so reading
+// them never scans the stack. The sums are exact. min and max are recomputed
+// only after the current extreme was popped, and everything is recomputed
+// after wholesale changes like an undo or once the squares overflowed.
+typedef struct {
+    __int128_t sum;
+    __int128_t sum_squares;
+    Number min;
+    Number max;
+    bool overflow;
+    bool sums_stale;
+    bool extremes_stale;
+} StackStats;
+
+// A chunk of a file backed stack that was used recently, and so is assumed
+// to be in memory.
+typedef struct {
+    size_t chunk;
+    uint64_t last_used;
+} StackChunk;
+
+// The first items are stored inline, so a zero initialized stack works
+// without touching the allocator. Past that the items move, once, into a
+// large reserved range of address space that is only backed by memory as it
+// gets used, so growing never copies. Since items may point into the stack
+// itself, a Stack must not be copied by value.
+//
+// A stack can instead live in a file mapped with stack_map_file. The mapping
+// then starts with file_header_size bytes owned by the caller, followed by
+// the items, and grows with ftruncate and mremap.
+//
+// A stack in memory growing past stack_memory_budget moves into an unlinked
+// spill file the same way. The memory of a file backed stack is then kept
+// near the budget by handing the least recently used chunks of the mapping
+// back to the kernel, which reads them again from the file when needed.
+typedef struct {
+    Number* items;
+    size_t count;
+    size_t capacity;
+    bool reserved;
+    char* file_mapping;
+    size_t file_size;
+    size_t file_header_size;
+    int file_fd;
+    // the file is a spill file, closed along with the stack
+    bool file_owned;
+    bool spill_failed;
+    StackChunk* resident;
+    size_t resident_count;
+    uint64_t use_clock;
+    // lowest index written since the history last looked at the stack
+    size_t dirty_from;
+    // bumped by every change, for caching things derived from the items
+    size_t generation;
+    StackStats stats;
+    Number inline_items[stack_inline_capacity];
+} Stack;
+
+// Number of allocations made for stack storage, for keeping an eye on it.
+extern size_t stack_allocation_count;
+
+// Bytes of items a stack keeps in memory before spilling to a file, 0 for no
+// limit.
+extern size_t stack_memory_budget;
+
+// Where spill files are created, stacks stay in memory while it is NULL.
+extern const char* stack_spill_directory;
+
+// Makes room for at least capacity items. Returns false, leaving the items
+// where they were, if out of memory.
+bool stack_reserve(Stack* stack, size_t capacity);
+
+// Returns false if out of memory.
+bool stack_push(Stack* stack, Number n);
+
+Number stack_pop(Stack* stack);
+
+// Forth style stack manipulation, working on the items in place. Items are
+// counted from the top, so 0 is the top. Each returns false and leaves the
+// stack alone when it does not hold enough items.
+
+// a -- a a
+bool stack_dup(Stack* stack);
+// a --
+bool stack_drop(Stack* stack);
+// a b -- b a
+bool stack_swap(Stack* stack);
+// a b -- a b a
+bool stack_over(Stack* stack);
+// a b c -- b c a
+bool stack_rot(Stack* stack);
+// copies item n to the top, 0 pick is dup
+bool stack_pick(Stack* stack, size_t n);
+// moves item n to the top, 2 roll is rot
+bool stack_roll(Stack* stack, size_t n);
+
+void stack_clear(Stack* stack);
+
+// Ascending, in place. Sorting needs a scratch copy of the stack, so both
+// return false and leave the stack alone for stacks past the memory budget
+// or when the copy can not be allocated.
+bool stack_sort(Stack* stack);
+
+// Sorts and drops repeated items.
+bool stack_unique(Stack* stack);
+
+// Nearest rank percentile of the items for p in (0, 100], leaving the stack
+// as it is. Selects on a copy, or for stacks past the memory budget by
+// streaming the stack once per 16 bits of the result. Both return false for
+// an empty stack or when out of memory.
+bool stack_percentile(Stack* stack, Number p, Number* n);
+
+// Middle item, or the mean of the two middle ones.
+bool stack_median(Stack* stack, Number* n);
+
+// Overwrites the item at index, counted from the bottom.
+void stack_set(Stack* stack, size_t index, Number n);
+
+// Marks items from index on as modified, for code writing to items directly.
+void stack_touch(Stack* stack, size_t index);
+
+// Has the statistics recomputed on their next use, for code replacing items
+// wholesale.
+void stack_invalidate_stats(Stack* stack);
+
+// Statistics of the whole stack, only meaningful when it is not empty.
+const StackStats* stack_stats(Stack* stack);
+
+Number stack_mean(Stack* stack);
+
+// Population variance.
+Number stack_variance(Stack* stack);
+
+// Replaces the contents of the stack with count items stored in the file
+// after a header of header_size bytes. The file stays open, owned by the
+// caller. Returns false if it could not be mapped.
+bool stack_map_file(Stack* stack, int fd, size_t header_size, size_t count);
+
+// Passes over the whole stack go a chunk at a time, so a stack larger than
+// the memory budget is streamed through instead of pushing out the hot top.
+// stack_stream_next returns where the chunk starting at begin ends and asks
+// for the next one to be read ahead. stack_stream_done drops the chunk again
+// unless it was recently used. Stacks within the budget are a single chunk.
+size_t stack_stream_next(Stack* stack, size_t begin);
+
+void stack_stream_done(Stack* stack, size_t begin, size_t end);
+
+// Lets the kernel drop the memory of items from begin to end, skipping the
+// recently used chunks. Does nothing for stacks in memory.
+void stack_release_items(Stack* stack, size_t begin, size_t end);
+
+// Lets the kernel drop the memory of a file backed stack that will not be
+// looked at for a while, it is read back from the file on the next access.
+// Does nothing for stacks in memory.
+void stack_page_out(Stack* stack);
+
+void stack_free(Stack* stack);
+
+#endif  // STACK_H_
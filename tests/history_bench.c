@@ -0,0 +1,74 @@
+// Measures the undo history on a 10^6 item stack: the memory each recorded
+// step adds to History.bytes, and how long undoing and redoing one step takes.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "history.h"
+#include "stack.h"
+
+#define bench_items 1000000
+#define bench_steps 5000
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void) {
+    Stack stack = {0};
+    History history = {0};
+
+    for (Number i = 0; i < bench_items; i++) stack_push(&stack, i);
+    history_commit(&history, &stack);
+    size_t base_bytes = history.bytes;
+
+    // what typing on the calculator does: push a value, or combine the top two
+    for (int step = 0; step < bench_steps; step++) {
+        if (step & 1) {
+            Number a = stack_pop(&stack);
+            Number b = stack_pop(&stack);
+            stack_push(&stack, a + b);
+        } else {
+            stack_push(&stack, step);
+        }
+        history_commit(&history, &stack);
+    }
+
+    size_t step_bytes = (history.bytes - base_bytes) / bench_steps;
+    printf("%d items: %zu bytes for the first version, %zu bytes per step\n",
+           bench_items, base_bytes, step_bytes);
+
+    double worst = 0;
+    double start = now();
+    for (int step = 0; step < bench_steps; step++) {
+        double t = now();
+        history_undo(&history, &stack);
+        t = now() - t;
+        if (t > worst) worst = t;
+    }
+    double undo = now() - start;
+
+    if (stack.count != bench_items || stack.items[bench_items - 1] !=
+                                          bench_items - 1) {
+        printf("undo did not restore the first version\n");
+        return EXIT_FAILURE;
+    }
+
+    start = now();
+    for (int step = 0; step < bench_steps; step++) {
+        history_redo(&history, &stack);
+    }
+    double redo = now() - start;
+
+    printf("undo %.2f us per step, %.2f us at worst, redo %.2f us per step\n",
+           undo / bench_steps * 1e6, worst * 1e6, redo / bench_steps * 1e6);
+
+    history_free(&history);
+    stack_free(&stack);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+// Times number_sort against qsort on 10^7 items, once with values spread
+// over the whole range and once with small integers, and checks that both
+// give the same order.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sort.h"
+
+#define bench_count 10000000
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// deterministic, so every run sorts the same items
+static uint64_t bench_seed = 1;
+
+static uint64_t bench_random(void) {
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return bench_seed;
+}
+
+static int number_compare(const void* a, const void* b) {
+    Number x = *(const Number*)a, y = *(const Number*)b;
+    return (x > y) - (x < y);
+}
+
+static bool bench(const char* name, Number* items, Number* copy) {
+    memcpy(copy, items, bench_count * sizeof(Number));
+
+    double start = now();
+    if (!number_sort(items, bench_count)) {
+        printf("%s: number_sort could not allocate\n", name);
+        return false;
+    }
+    double radix = now() - start;
+
+    start = now();
+    qsort(copy, bench_count, sizeof(Number), number_compare);
+    double quick = now() - start;
+
+    printf("%s: number_sort %.2f s, qsort %.2f s\n", name, radix, quick);
+    if (memcmp(items, copy, bench_count * sizeof(Number)) != 0) {
+        printf("%s: number_sort and qsort disagree\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(void) {
+    Number* items = malloc(bench_count * sizeof(Number));
+    Number* copy = malloc(bench_count * sizeof(Number));
+    if (!items || !copy) return EXIT_FAILURE;
+
+    bool ok = true;
+
+    for (size_t i = 0; i < bench_count; i++) items[i] = bench_random();
+    ok &= bench("random", items, copy);
+
+    for (size_t i = 0; i < bench_count; i++) {
+        items[i] = (Number)(bench_random() % 1000) * number_scaling_factor;
+    }
+    ok &= bench("small integers", items, copy);
+
+    free(items);
+    free(copy);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
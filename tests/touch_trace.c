@@ -0,0 +1,195 @@
+// Replays a trace of two thumbs tapping a row of keys as fast as the frame
+// rate allows through imgui.c, with raylib's input reduced to the touch
+// points of each frame, and checks that every finger-down and finger-up pair
+// on a key clicks it exactly once, in the frame the finger is lifted. Taps
+// shorter than a frame are left out, raylib never reports them.
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "font.h"
+#include "imgui.h"
+
+#define key_count 10
+#define key_width 10
+#define frame_count 100000
+#define thumb_count 2
+#define max_taps (frame_count * thumb_count)
+
+// A finger down on key from frame down until it is lifted in frame up. A
+// slide moves it to the next key before it is lifted, which must not click.
+typedef struct {
+    int id;
+    int key;
+    int down;
+    int up;
+    bool slide;
+} Tap;
+
+// the taps of each thumb follow each other in the order they happen
+static Tap taps[max_taps];
+static int tap_count;
+static int thumb_taps[thumb_count + 1];
+// per thumb, its first tap not lifted before the current frame
+static int thumb_cursor[thumb_count];
+
+// the touch points raylib would report in the current frame
+static int touch_count;
+static int touch_ids[thumb_count];
+static Vector2 touch_positions[thumb_count];
+static int previous_touch_count;
+
+// deterministic, so a failing trace replays the same way
+static unsigned trace_seed = 1;
+
+static int trace_random(int n) {
+    trace_seed = trace_seed * 1103515245u + 12345u;
+    return (trace_seed >> 16) % n;
+}
+
+// Each thumb taps a random key for 1 to 3 frames and rests 0 to 2 frames,
+// where 0 puts a new finger down in the frame the last one is lifted.
+static void trace_generate(void) {
+    for (int thumb = 0; thumb < thumb_count; thumb++) {
+        thumb_taps[thumb] = thumb_cursor[thumb] = tap_count;
+        int frame = trace_random(3);
+        while (tap_count < max_taps) {
+            int up = frame + 1 + trace_random(3);
+            if (up >= frame_count) break;
+            taps[tap_count] = (Tap){
+                .id = tap_count,
+                .key = trace_random(key_count - 1),
+                .down = frame,
+                .up = up,
+                // a finger must have been down a frame before it slides
+                .slide = up - frame > 1 && trace_random(8) == 0,
+            };
+            tap_count++;
+            frame = up + trace_random(3);
+        }
+    }
+    thumb_taps[thumb_count] = tap_count;
+}
+
+// Sets the touch points of frame, and counts the clicks the taps lifted in
+// it should make.
+static void trace_frame(int frame, int* expected) {
+    previous_touch_count = touch_count;
+    touch_count = 0;
+    for (int thumb = 0; thumb < thumb_count; thumb++) {
+        int* i = &thumb_cursor[thumb];
+        for (; *i < thumb_taps[thumb + 1] && taps[*i].up <= frame; (*i)++) {
+            if (!taps[*i].slide) expected[taps[*i].key]++;
+        }
+        if (*i == thumb_taps[thumb + 1]) continue;
+
+        const Tap* tap = &taps[*i];
+        if (frame < tap->down) continue;
+        int key = tap->key;
+        if (tap->slide && frame + 1 == tap->up) key++;
+        touch_ids[touch_count] = tap->id;
+        touch_positions[touch_count] =
+            (Vector2){key * key_width + key_width / 2.f, 5};
+        touch_count++;
+    }
+}
+
+int main(void) {
+    trace_generate();
+
+    int expected[key_count] = {0};
+    int clicked[key_count] = {0};
+    int failures = 0;
+
+    for (int frame = 0; frame < frame_count; frame++) {
+        int frame_expected[key_count] = {0};
+        trace_frame(frame, frame_expected);
+
+        im_begin_frame();
+        for (int k = 0; k < key_count; k++) {
+            Rectangle rec = {k * key_width, 0, key_width, 10};
+            int clicks = im_button_state(im_id("key", k), rec).clicks;
+            if (clicks != frame_expected[k] && failures++ < 10) {
+                printf("frame %d key %d: %d clicks, expected %d\n", frame, k,
+                       clicks, frame_expected[k]);
+            }
+            clicked[k] += clicks;
+            expected[k] += frame_expected[k];
+        }
+        im_end_frame();
+    }
+
+    int total_clicked = 0, total_expected = 0;
+    for (int k = 0; k < key_count; k++) {
+        total_clicked += clicked[k];
+        total_expected += expected[k];
+    }
+    printf("%d taps, %d clicks expected, %d clicked\n", tap_count,
+           total_expected, total_clicked);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// touch input as replayed from the trace, with the first touch also reported
+// as the mouse the way raylib does on Android
+
+int GetTouchPointCount(void) { return touch_count; }
+
+int GetTouchPointId(int index) { return touch_ids[index]; }
+
+Vector2 GetTouchPosition(int index) { return touch_positions[index]; }
+
+Vector2 GetMousePosition(void) {
+    return touch_count ? touch_positions[0] : (Vector2){0, 0};
+}
+
+bool IsMouseButtonDown(int button) { return touch_count > 0; }
+
+bool IsMouseButtonPressed(int button) {
+    return touch_count && !previous_touch_count;
+}
+
+bool IsMouseButtonReleased(int button) {
+    return !touch_count && previous_touch_count;
+}
+
+bool CheckCollisionPointRec(Vector2 point, Rectangle rec) {
+    return point.x >= rec.x && point.x < rec.x + rec.width &&
+           point.y >= rec.y && point.y < rec.y + rec.height;
+}
+
+// nothing is drawn
+
+int GetRenderWidth(void) { return key_count * key_width; }
+
+int GetRenderHeight(void) { return 10; }
+
+void BeginScissorMode(int x, int y, int width, int height) {}
+
+void EndScissorMode(void) {}
+
+void DrawTexturePro(Texture2D texture, Rectangle source, Rectangle dest,
+                    Vector2 origin, float rotation, Color tint) {}
+
+Font GetFontDefault(void) { return (Font){0}; }
+
+int GetGlyphIndex(Font font, int codepoint) { return 0; }
+
+int GetCodepointNext(const char* text, int* codepoint_size) {
+    *codepoint_size = 1;
+    return *text;
+}
+
+int MeasureText(const char* text, int font_size) { return 0; }
+
+void font_begin(void) {}
+
+void font_end(void) {}
+
+const Font* font_get(void) {
+    static Font font;
+    return &font;
+}
+
+Rectangle font_white_rect(void) { return (Rectangle){0}; }